@@ -0,0 +1,348 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <execution>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "data_generator.h"
+#include "process_queries.h"
+#include "search_server.h"
+#include "string_processing.h"
+
+using namespace std;
+
+namespace
+{
+    using Clock = chrono::steady_clock;
+
+    // Параметры прогона; задаются ключами командной строки вида --name=value
+    struct BenchmarkConfig
+    {
+        int dictionary_size = 10'000;
+        int max_word_length = 10;
+        int document_count = 20'000;
+        int max_document_word_count = 70;
+        int query_count = 2'000;
+        int max_query_word_count = 7;
+        double zipf_exponent = 1.0;
+        int repeat_count = 5;
+        unsigned seed = 1;
+        bool is_json_output = false;
+    };
+
+    // Замеры одного сценария. Замер - длительность одной операции, обработавшей item_count элементов
+    // (документов или запросов).
+    struct BenchmarkResult
+    {
+        string name;
+        size_t item_count = 0;
+        vector<double> sample_seconds;
+    };
+
+    struct Corpus
+    {
+        vector<string> dictionary;
+        vector<string> documents;
+        vector<string> queries;
+    };
+
+    // Накопитель, не дающий компилятору выбросить результаты замеряемых вызовов
+    uint64_t checksum = 0;
+
+    BenchmarkConfig ParseCommandLine(int argc, char** argv)
+    {
+        BenchmarkConfig config;
+        for (int i = 1; i < argc; ++i)
+        {
+            const string_view argument = argv[i];
+            const size_t value_position = argument.find('=');
+            const string_view name = argument.substr(0, value_position);
+            const string value(value_position == string_view::npos ? string_view() : argument.substr(value_position + 1));
+            if (name == "--format"sv)
+            {
+                if (value != "text"s && value != "json"s)
+                    throw invalid_argument("Параметры : неизвестный формат вывода "s + value);
+                config.is_json_output = value == "json"s;
+            }
+            else if (value.empty())
+                throw invalid_argument("Параметры : не задано значение ключа "s + string(name));
+            else if (name == "--dictionary"sv)
+                config.dictionary_size = stoi(value);
+            else if (name == "--word-length"sv)
+                config.max_word_length = stoi(value);
+            else if (name == "--documents"sv)
+                config.document_count = stoi(value);
+            else if (name == "--document-words"sv)
+                config.max_document_word_count = stoi(value);
+            else if (name == "--queries"sv)
+                config.query_count = stoi(value);
+            else if (name == "--query-words"sv)
+                config.max_query_word_count = stoi(value);
+            else if (name == "--zipf"sv)
+                config.zipf_exponent = stod(value);
+            else if (name == "--repeats"sv)
+                config.repeat_count = stoi(value);
+            else if (name == "--seed"sv)
+                config.seed = stoul(value);
+            else
+                throw invalid_argument("Параметры : неизвестный ключ "s + string(name));
+        }
+        if (config.dictionary_size <= 0 || config.max_word_length <= 0 || config.document_count <= 0 ||
+            config.max_document_word_count <= 0 || config.query_count <= 0 || config.max_query_word_count <= 0 ||
+            config.repeat_count <= 0)
+            throw invalid_argument("Параметры : размеры и количество повторов должны быть положительными"s);
+        return config;
+    }
+
+    Corpus GenerateCorpus(const BenchmarkConfig& config)
+    {
+        mt19937 generator(config.seed);
+        Corpus corpus;
+        corpus.dictionary = GenerateDictionary(generator, config.dictionary_size, config.max_word_length);
+        const ZipfDistribution word_distribution(corpus.dictionary.size(), config.zipf_exponent);
+        corpus.documents = GenerateQueries(generator, corpus.dictionary, config.document_count,
+                                           config.max_document_word_count, word_distribution);
+        corpus.queries = GenerateQueries(generator, corpus.dictionary, config.query_count,
+                                         config.max_query_word_count, word_distribution);
+        return corpus;
+    }
+
+    // Замеряет одну операцию
+    template <class Operation>
+    void Measure(BenchmarkResult& result, Operation operation)
+    {
+        const Clock::time_point start_time = Clock::now();
+        operation();
+        result.sample_seconds.push_back(chrono::duration<double>(Clock::now() - start_time).count());
+    }
+
+    // Стоп-словом служит самое частое слово корпуса
+    SearchServer BuildServer(const Corpus& corpus)
+    {
+        SearchServer search_server(corpus.dictionary[0]);
+        vector<DocumentToAdd> documents;
+        documents.reserve(corpus.documents.size());
+        for (size_t i = 0; i < corpus.documents.size(); ++i)
+            documents.push_back({static_cast<int>(i), corpus.documents[i], DocumentStatus::ACTUAL, {1, 2, 3}});
+        search_server.AddDocuments(execution::par, documents);
+        return search_server;
+    }
+
+    BenchmarkResult BenchmarkTokenization(const Corpus& corpus, int repeat_count)
+    {
+        BenchmarkResult result{"SplitIntoWords"s, 1, {}};
+        vector<string_view> words;
+        for (int repeat = 0; repeat < repeat_count; ++repeat)
+            for (const string& document : corpus.documents)
+                Measure(result, [&document, &words]
+                                {
+                                    SplitIntoWords(document, words);
+                                    checksum += words.size();
+                                });
+        return result;
+    }
+
+    BenchmarkResult BenchmarkAddDocument(const Corpus& corpus, int repeat_count)
+    {
+        BenchmarkResult result{"AddDocument"s, 1, {}};
+        for (int repeat = 0; repeat < repeat_count; ++repeat)
+        {
+            SearchServer search_server(corpus.dictionary[0]);
+            for (size_t i = 0; i < corpus.documents.size(); ++i)
+                Measure(result, [&search_server, &corpus, i]
+                                {
+                                    search_server.AddDocument(i, corpus.documents[i], DocumentStatus::ACTUAL, {1, 2, 3});
+                                });
+            checksum += search_server.GetDocumentCount();
+        }
+        return result;
+    }
+
+    template <class ExecutionPolicy>
+    BenchmarkResult BenchmarkFindTopDocuments(string name, const SearchServer& search_server, const Corpus& corpus,
+                                              int repeat_count, ExecutionPolicy&& policy)
+    {
+        BenchmarkResult result{move(name), 1, {}};
+        for (int repeat = 0; repeat < repeat_count; ++repeat)
+            for (const string& query : corpus.queries)
+                Measure(result, [&search_server, &query, &policy]
+                                {
+                                    checksum += search_server.FindTopDocuments(policy, query).size();
+                                });
+        return result;
+    }
+
+    BenchmarkResult BenchmarkMatchDocument(const SearchServer& search_server, const Corpus& corpus, int repeat_count)
+    {
+        BenchmarkResult result{"MatchDocument"s, 1, {}};
+        for (int repeat = 0; repeat < repeat_count; ++repeat)
+            for (size_t i = 0; i < corpus.queries.size(); ++i)
+            {
+                const int document_id = i % corpus.documents.size();
+                Measure(result, [&search_server, &corpus, i, document_id]
+                                {
+                                    checksum += get<0>(search_server.MatchDocument(execution::seq, corpus.queries[i],
+                                                                                   document_id)).size();
+                                });
+            }
+        return result;
+    }
+
+    // Каждый запрос сопоставляется со страницей из MATCH_PAGE_SIZE документов, как при подсветке выдачи
+    BenchmarkResult BenchmarkMatchDocuments(const SearchServer& search_server, const Corpus& corpus, int repeat_count)
+    {
+        static constexpr size_t MATCH_PAGE_SIZE = 50;
+        BenchmarkResult result{"MatchDocuments"s, MATCH_PAGE_SIZE, {}};
+        vector<int> document_ids(MATCH_PAGE_SIZE);
+        for (int repeat = 0; repeat < repeat_count; ++repeat)
+            for (size_t i = 0; i < corpus.queries.size(); ++i)
+            {
+                for (size_t j = 0; j < MATCH_PAGE_SIZE; ++j)
+                    document_ids[j] = (i + j) % corpus.documents.size();
+                Measure(result, [&search_server, &corpus, &document_ids, i]
+                                {
+                                    checksum += search_server.MatchDocuments(corpus.queries[i], document_ids).size();
+                                });
+            }
+        return result;
+    }
+
+    BenchmarkResult BenchmarkProcessQueries(const SearchServer& search_server, const Corpus& corpus, int repeat_count)
+    {
+        BenchmarkResult result{"ProcessQueries"s, corpus.queries.size(), {}};
+        for (int repeat = 0; repeat < repeat_count; ++repeat)
+            Measure(result, [&search_server, &corpus]
+                            {
+                                checksum += ProcessQueries(search_server, corpus.queries).size();
+                            });
+        return result;
+    }
+
+    // Удаляется каждый десятый документ в случайном порядке; индекс перед каждым повтором строится заново
+    BenchmarkResult BenchmarkRemoveDocument(const Corpus& corpus, int repeat_count, unsigned seed)
+    {
+        BenchmarkResult result{"RemoveDocument"s, 1, {}};
+        vector<int> document_ids(corpus.documents.size());
+        iota(document_ids.begin(), document_ids.end(), 0);
+        mt19937 generator(seed);
+        for (int repeat = 0; repeat < repeat_count; ++repeat)
+        {
+            SearchServer search_server = BuildServer(corpus);
+            shuffle(document_ids.begin(), document_ids.end(), generator);
+            for (size_t i = 0; i < document_ids.size(); i += 10)
+                Measure(result, [&search_server, document_id = document_ids[i]]
+                                {
+                                    search_server.RemoveDocument(document_id);
+                                });
+            checksum += search_server.GetDocumentCount();
+        }
+        return result;
+    }
+
+    // Квантиль упорядоченной выборки: значение, не меньшее доли quantile замеров
+    double GetQuantile(const vector<double>& sorted_samples, double quantile)
+    {
+        const size_t position = static_cast<size_t>(quantile * (sorted_samples.size() - 1) + 0.5);
+        return sorted_samples[min(position, sorted_samples.size() - 1)];
+    }
+
+    struct BenchmarkSummary
+    {
+        double median_nanoseconds;
+        double p99_nanoseconds;
+        double items_per_second;
+    };
+
+    BenchmarkSummary Summarize(const BenchmarkResult& result)
+    {
+        vector<double> samples = result.sample_seconds;
+        sort(samples.begin(), samples.end());
+        const double total_seconds = accumulate(samples.begin(), samples.end(), 0.0);
+        return {GetQuantile(samples, 0.5) * 1e9, GetQuantile(samples, 0.99) * 1e9,
+                total_seconds > 0 ? samples.size() * result.item_count / total_seconds : 0.0};
+    }
+
+    void PrintText(ostream& out, const BenchmarkConfig& config, const vector<BenchmarkResult>& results)
+    {
+        out << "documents="s << config.document_count << " queries="s << config.query_count
+            << " dictionary="s << config.dictionary_size << " zipf="s << config.zipf_exponent
+            << " repeats="s << config.repeat_count << " seed="s << config.seed << endl;
+        out << left << setw(28) << "benchmark"s << right << setw(10) << "samples"s << setw(16) << "median, ns"s
+            << setw(16) << "p99, ns"s << setw(16) << "items/s"s << endl;
+        for (const BenchmarkResult& result : results)
+        {
+            const BenchmarkSummary summary = Summarize(result);
+            out << left << setw(28) << result.name << right << setw(10) << result.sample_seconds.size()
+                << fixed << setprecision(0) << setw(16) << summary.median_nanoseconds
+                << setw(16) << summary.p99_nanoseconds << setw(16) << summary.items_per_second << endl;
+            out.unsetf(ios::floatfield);
+        }
+        out << "checksum="s << checksum << endl;
+    }
+
+    // Одна строка JSON на весь прогон, чтобы результаты разных сборок было удобно сохранять и сравнивать
+    void PrintJson(ostream& out, const BenchmarkConfig& config, const vector<BenchmarkResult>& results)
+    {
+        out << setprecision(12);
+        out << "{\"config\":{\"documents\":"s << config.document_count << ",\"document_words\":"s
+            << config.max_document_word_count << ",\"queries\":"s << config.query_count << ",\"query_words\":"s
+            << config.max_query_word_count << ",\"dictionary\":"s << config.dictionary_size << ",\"word_length\":"s
+            << config.max_word_length << ",\"zipf\":"s << config.zipf_exponent << ",\"repeats\":"s
+            << config.repeat_count << ",\"seed\":"s << config.seed << "},\"results\":["s;
+        bool is_first = true;
+        for (const BenchmarkResult& result : results)
+        {
+            const BenchmarkSummary summary = Summarize(result);
+            out << (is_first ? ""s : ","s) << "{\"name\":\""s << result.name << "\",\"samples\":"s
+                << result.sample_seconds.size() << ",\"items_per_sample\":"s << result.item_count
+                << ",\"median_ns\":"s << summary.median_nanoseconds << ",\"p99_ns\":"s << summary.p99_nanoseconds
+                << ",\"items_per_second\":"s << summary.items_per_second << "}"s;
+            is_first = false;
+        }
+        out << "],\"checksum\":"s << checksum << "}"s << endl;
+    }
+}
+
+// Замер производительности основных операций поискового сервера на сгенерированном корпусе.
+// Каждый сценарий повторяется --repeats раз; для каждого выводятся медиана и 99-й процентиль длительности
+// одной операции и пропускная способность в документах или запросах в секунду.
+int main(int argc, char** argv)
+{
+    try
+    {
+        const BenchmarkConfig config = ParseCommandLine(argc, argv);
+        const Corpus corpus = GenerateCorpus(config);
+
+        vector<BenchmarkResult> results;
+        results.push_back(BenchmarkTokenization(corpus, config.repeat_count));
+        results.push_back(BenchmarkAddDocument(corpus, config.repeat_count));
+        {
+            const SearchServer search_server = BuildServer(corpus);
+            results.push_back(BenchmarkFindTopDocuments("FindTopDocuments/seq"s, search_server, corpus,
+                                                        config.repeat_count, execution::seq));
+            results.push_back(BenchmarkFindTopDocuments("FindTopDocuments/par"s, search_server, corpus,
+                                                        config.repeat_count, execution::par));
+            results.push_back(BenchmarkMatchDocument(search_server, corpus, config.repeat_count));
+            results.push_back(BenchmarkMatchDocuments(search_server, corpus, config.repeat_count));
+            results.push_back(BenchmarkProcessQueries(search_server, corpus, config.repeat_count));
+        }
+        results.push_back(BenchmarkRemoveDocument(corpus, config.repeat_count, config.seed));
+
+        if (config.is_json_output)
+            PrintJson(cout, config, results);
+        else
+            PrintText(cout, config, results);
+    }
+    catch (const exception& e)
+    {
+        cerr << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}
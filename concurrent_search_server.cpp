@@ -0,0 +1,90 @@
+#include <functional>
+#include <thread>
+#include "concurrent_search_server.h"
+
+using namespace std;
+
+ConcurrentSearchServer::ReadGuard::ReadGuard(const ConcurrentSearchServer& concurrent_server) :
+    reader_count_(concurrent_server.read_indicators_[concurrent_server.read_indicator_index_.load()][GetReadIndicatorSlot()].reader_count)
+{
+    reader_count_.fetch_add(1);
+}
+
+ConcurrentSearchServer::ReadGuard::~ReadGuard()
+{
+    reader_count_.fetch_sub(1);
+}
+
+ConcurrentSearchServer::ConcurrentSearchServer(string_view stop_words_text) :
+    servers_{SearchServer(stop_words_text), SearchServer(stop_words_text)}
+{}
+
+vector<Document> ConcurrentSearchServer::FindTopDocuments(string_view raw_query, DocumentStatus demand_status) const
+{
+    return Read([raw_query, demand_status](const SearchServer& search_server)
+                {
+                    return search_server.FindTopDocuments(raw_query, demand_status);
+                });
+}
+
+int ConcurrentSearchServer::GetDocumentCount() const
+{
+    return Read([](const SearchServer& search_server)
+                {
+                    return search_server.GetDocumentCount();
+                });
+}
+
+void ConcurrentSearchServer::AddDocument(int document_id, string_view document, DocumentStatus status, const vector<int>& ratings)
+{
+    Write([document_id, document, status, &ratings](SearchServer& search_server)
+          {
+              search_server.AddDocument(document_id, document, status, ratings);
+          });
+}
+
+vector<AddDocumentError> ConcurrentSearchServer::AddDocuments(const vector<DocumentToAdd>& documents)
+{
+    vector<AddDocumentError> errors;
+    Write([&documents, &errors](SearchServer& search_server)
+          {
+              errors = search_server.AddDocuments(execution::par, documents);
+          });
+    return errors;
+}
+
+void ConcurrentSearchServer::RemoveDocument(int document_id)
+{
+    Write([document_id](SearchServer& search_server)
+          {
+              search_server.RemoveDocument(document_id);
+          });
+}
+
+size_t ConcurrentSearchServer::GetReadIndicatorSlot()
+{
+    thread_local const size_t slot = hash<thread::id>()(this_thread::get_id()) % READ_INDICATOR_SLOT_COUNT;
+    return slot;
+}
+
+bool ConcurrentSearchServer::IsEmpty(const ReadIndicator& read_indicator)
+{
+    for (const ReadIndicatorSlot& read_indicator_slot : read_indicator)
+        if (read_indicator_slot.reader_count.load() != 0)
+            return false;
+    return true;
+}
+
+void ConcurrentSearchServer::WaitForReaders()
+{
+    // Новые читатели уже видят новую активную копию. Сначала дожидаемся ухода запоздалых читателей
+    // неиспользуемого счётчика, затем переводим новых читателей на него и дожидаемся ухода всех,
+    // кто отмечен в прежнем счётчике.
+    const size_t previous_index = read_indicator_index_.load();
+    const size_t next_index = previous_index ^ 1;
+    while (!IsEmpty(read_indicators_[next_index]))
+        this_thread::yield();
+    read_indicator_index_.store(next_index);
+    while (!IsEmpty(read_indicators_[previous_index]))
+        this_thread::yield();
+}
@@ -0,0 +1,107 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "document.h"
+#include "search_server.h"
+
+// Поисковый сервер, допускающий поиск одновременно с изменением индекса (схема left-right).
+// Сервер хранит две одинаковые копии индекса. Читатели работают с активной копией, не беря блокировок:
+// вход и выход читателя - по одной атомарной операции над счётчиком, так что запись никогда не задерживает
+// поиск. Писатель (писатели выполняются по очереди) сначала изменяет неактивную копию, затем атомарно
+// делает её активной, дожидается ухода читателей прежней копии и повторяет то же изменение на ней.
+// Каждый читатель до конца чтения видит одну согласованную версию индекса. Платой служат двойной объём
+// памяти и двойная работа при записи.
+class ConcurrentSearchServer
+{
+public:
+    template <template <typename ValueType> typename Container>
+    explicit ConcurrentSearchServer(const Container<std::string>& stop_words) :
+        servers_{SearchServer(stop_words), SearchServer(stop_words)}
+    {}
+
+    explicit ConcurrentSearchServer(std::string_view stop_words_text);
+
+    // Вызывает reader(const SearchServer&) для текущей версии индекса и возвращает его результат.
+    // Ссылки и string_view на данные сервера, полученные внутри reader, после его завершения недействительны.
+    template <class Reader>
+    decltype(auto) Read(Reader&& reader) const
+    {
+        const ReadGuard read_guard(*this);
+        return reader(static_cast<const SearchServer&>(servers_[active_server_index_.load()]));
+    }
+
+    // Применяет writer(SearchServer&) к обеим копиям индекса. writer должен изменять индекс детерминированно:
+    // одинаковые вызовы для одинаковых копий должны приводить к одинаковому результату. Если writer выбросит
+    // исключение на первой копии, изменение не публикуется; исключение должно оставлять копию неизменной.
+    template <class Writer>
+    void Write(Writer&& writer)
+    {
+        const std::lock_guard write_lock(write_mutex_);
+        const size_t active_server_index = active_server_index_.load();
+        writer(servers_[active_server_index ^ 1]);
+        active_server_index_.store(active_server_index ^ 1);
+        WaitForReaders();
+        writer(servers_[active_server_index]);
+    }
+
+    std::vector<Document> FindTopDocuments(std::string_view raw_query,
+                                           DocumentStatus demand_status = DocumentStatus::ACTUAL) const;
+
+    template <class DocumentPredicate>
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate) const
+    {
+        return Read([raw_query, &document_predicate](const SearchServer& search_server)
+                    {
+                        return search_server.FindTopDocuments(raw_query, document_predicate);
+                    });
+    }
+
+    int GetDocumentCount() const;
+
+    void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+    std::vector<AddDocumentError> AddDocuments(const std::vector<DocumentToAdd>& documents);
+    void RemoveDocument(int document_id);
+
+private:
+    static constexpr size_t READ_INDICATOR_SLOT_COUNT = 16;
+
+    // Счётчик читателей, распределённый по ячейкам отдельных строк кэша, чтобы читатели разных потоков
+    // не соперничали за одну ячейку
+    struct alignas(64) ReadIndicatorSlot
+    {
+        std::atomic<int> reader_count{0};
+    };
+
+    using ReadIndicator = std::array<ReadIndicatorSlot, READ_INDICATOR_SLOT_COUNT>;
+
+    class ReadGuard
+    {
+    public:
+        explicit ReadGuard(const ConcurrentSearchServer& concurrent_server);
+        ReadGuard(const ReadGuard&) = delete;
+        ReadGuard& operator=(const ReadGuard&) = delete;
+        ~ReadGuard();
+
+    private:
+        std::atomic<int>& reader_count_;
+    };
+
+    std::array<SearchServer, 2> servers_;
+    std::atomic<size_t> active_server_index_{0};
+    // Читатели отмечаются в одном из двух счётчиков; писатель переключает их, чтобы дождаться ухода
+    // читателей, вошедших до публикации, не дожидаясь вошедших после
+    mutable std::array<ReadIndicator, 2> read_indicators_;
+    std::atomic<size_t> read_indicator_index_{0};
+    std::mutex write_mutex_;
+
+    static size_t GetReadIndicatorSlot();
+    static bool IsEmpty(const ReadIndicator& read_indicator);
+    // Дожидается, пока не завершатся все чтения, начатые до последней смены активной копии
+    void WaitForReaders();
+};
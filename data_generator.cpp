@@ -0,0 +1,97 @@
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "data_generator.h"
+
+using namespace std;
+
+string GenerateWord(mt19937& generator, int max_length)
+{
+    const int length = uniform_int_distribution(1, max_length)(generator);
+    string word;
+    word.reserve(length);
+    for (int i = 0; i < length; ++i)
+        word.push_back(uniform_int_distribution('a', 'z')(generator));
+    return word;
+}
+
+vector<string> GenerateDictionary(mt19937& generator, int word_count, int max_length)
+{
+    vector<string> words;
+    words.reserve(word_count);
+    for (int i = 0; i < word_count; ++i)
+        words.push_back(GenerateWord(generator, max_length));
+    sort(words.begin(), words.end());
+    words.erase(unique(words.begin(), words.end()), words.end());
+    return words;
+}
+
+string GenerateQuery(mt19937& generator, const vector<string>& dictionary, int max_word_count)
+{
+    const int word_count = uniform_int_distribution(1, max_word_count)(generator);
+    string query;
+    for (int i = 0; i < word_count; ++i)
+    {
+        if (!query.empty())
+            query.push_back(' ');
+        query += dictionary[uniform_int_distribution<int>(0, dictionary.size() - 1)(generator)];
+    }
+    return query;
+}
+
+vector<string> GenerateQueries(mt19937& generator, const vector<string>& dictionary, int query_count, int max_word_count)
+{
+    vector<string> queries;
+    queries.reserve(query_count);
+    for (int i = 0; i < query_count; ++i)
+        queries.push_back(GenerateQuery(generator, dictionary, max_word_count));
+    return queries;
+}
+
+ZipfDistribution::ZipfDistribution(size_t size, double exponent)
+{
+    if (size == 0)
+        throw invalid_argument("Распределение Ципфа : пустой набор значений"s);
+    if (exponent < 0)
+        throw invalid_argument("Распределение Ципфа : отрицательный показатель"s);
+    cumulative_weights_.reserve(size);
+    double cumulative_weight = 0;
+    for (size_t rank = 0; rank < size; ++rank)
+    {
+        cumulative_weight += 1.0 / pow(static_cast<double>(rank + 1), exponent);
+        cumulative_weights_.push_back(cumulative_weight);
+    }
+}
+
+size_t ZipfDistribution::operator()(mt19937& generator) const
+{
+    const double weight = uniform_real_distribution<double>(0, cumulative_weights_.back())(generator);
+    const auto weight_it = upper_bound(cumulative_weights_.begin(), cumulative_weights_.end(), weight);
+    return min<size_t>(weight_it - cumulative_weights_.begin(), cumulative_weights_.size() - 1);
+}
+
+string GenerateQuery(mt19937& generator, const vector<string>& dictionary, int max_word_count,
+                     const ZipfDistribution& word_distribution)
+{
+    const int word_count = uniform_int_distribution(1, max_word_count)(generator);
+    string query;
+    for (int i = 0; i < word_count; ++i)
+    {
+        if (!query.empty())
+            query.push_back(' ');
+        query += dictionary[word_distribution(generator)];
+    }
+    return query;
+}
+
+vector<string> GenerateQueries(mt19937& generator, const vector<string>& dictionary, int query_count, int max_word_count,
+                               const ZipfDistribution& word_distribution)
+{
+    vector<string> queries;
+    queries.reserve(query_count);
+    for (int i = 0; i < query_count; ++i)
+        queries.push_back(GenerateQuery(generator, dictionary, max_word_count, word_distribution));
+    return queries;
+}
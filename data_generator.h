@@ -0,0 +1,35 @@
+#pragma once
+#include <cstddef>
+#include <random>
+#include <string>
+#include <vector>
+
+// Генераторы случайных словарей, документов и запросов для проверки производительности
+
+std::string GenerateWord(std::mt19937& generator, int max_length);
+// Упорядоченный словарь без повторов из не более чем word_count слов длиной до max_length букв
+std::vector<std::string> GenerateDictionary(std::mt19937& generator, int word_count, int max_length);
+// Текст от 1 до max_word_count слов словаря, выбранных равновероятно
+std::string GenerateQuery(std::mt19937& generator, const std::vector<std::string>& dictionary, int max_word_count);
+std::vector<std::string> GenerateQueries(std::mt19937& generator, const std::vector<std::string>& dictionary,
+                                         int query_count, int max_word_count);
+
+// Распределение номеров от 0 до size - 1 по закону Ципфа: вероятность номера r пропорциональна
+// 1 / (r + 1)^exponent. При exponent = 0 все номера равновероятны, с ростом exponent выборка всё
+// сильнее сосредоточивается на первых номерах, как слова естественного языка.
+class ZipfDistribution
+{
+public:
+    ZipfDistribution(size_t size, double exponent);
+
+    size_t operator()(std::mt19937& generator) const;
+
+private:
+    std::vector<double> cumulative_weights_;
+};
+
+// То же, что GenerateQuery, но слова словаря выбираются по распределению word_distribution
+std::string GenerateQuery(std::mt19937& generator, const std::vector<std::string>& dictionary, int max_word_count,
+                          const ZipfDistribution& word_distribution);
+std::vector<std::string> GenerateQueries(std::mt19937& generator, const std::vector<std::string>& dictionary,
+                                         int query_count, int max_word_count, const ZipfDistribution& word_distribution);
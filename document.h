@@ -1,4 +1,5 @@
 #pragma once
+#include <cstdint>
 
 struct Document
 {
@@ -9,7 +10,7 @@ struct Document
     int rating;
 };
 
-enum class DocumentStatus
+enum class DocumentStatus : uint8_t
 {
     ACTUAL,
     IRRELEVANT,
@@ -0,0 +1,65 @@
+#include <algorithm>
+#include "forward_index.h"
+
+using namespace std;
+
+const ForwardEntry* ForwardEntries::SeekTerm(const ForwardEntry* from, TermId term_id) const
+{
+    const size_t size = last_ - from;
+    size_t bound = 1;
+    while (bound <= size && from[bound - 1].term_id < term_id)
+        bound *= 2;
+    // Все записи до from[bound / 2] заведомо меньше искомой
+    return lower_bound(from + bound / 2, from + min(bound, size), term_id,
+                       [](const ForwardEntry& entry, TermId term_id)
+                       {
+                           return entry.term_id < term_id;
+                       });
+}
+
+void ForwardIndex::AddDocument(const vector<ForwardEntry>& entries)
+{
+    documents_.push_back({entries_.size(), static_cast<uint32_t>(entries.size())});
+    const auto document_begin = entries_.insert(entries_.end(), entries.begin(), entries.end());
+    sort(document_begin, entries_.end(),
+         [](const ForwardEntry& lhs, const ForwardEntry& rhs)
+         {
+             return lhs.term_id < rhs.term_id;
+         });
+}
+
+void ForwardIndex::RemoveDocument(int ordinal)
+{
+    dead_entry_count_ += documents_[ordinal].size;
+    documents_[ordinal].size = 0;
+    if (dead_entry_count_ >= MIN_COMPACTION_DEAD_ENTRY_COUNT && dead_entry_count_ * 2 >= entries_.size())
+        Compact();
+}
+
+void ForwardIndex::RenumberDocuments(const vector<int>& new_ordinals)
+{
+    size_t document_count = 0;
+    for (size_t ordinal = 0; ordinal < documents_.size(); ++ordinal)
+        if (new_ordinals[ordinal] >= 0)
+            documents_[document_count++] = documents_[ordinal];
+    documents_.resize(document_count);
+    documents_.shrink_to_fit();
+    Compact();
+}
+
+void ForwardIndex::Compact()
+{
+    // Отрезки документов упорядочены по порядковым номерам, поэтому записи действующих документов
+    // переносятся к началу массива на месте, без дополнительной памяти
+    uint64_t entry_count = 0;
+    for (DocumentEntries& document : documents_)
+    {
+        copy(entries_.begin() + document.offset, entries_.begin() + document.offset + document.size,
+             entries_.begin() + entry_count);
+        document.offset = entry_count;
+        entry_count += document.size;
+    }
+    entries_.resize(entry_count);
+    entries_.shrink_to_fit();
+    dead_entry_count_ = 0;
+}
@@ -0,0 +1,200 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory_resource>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "term_dictionary.h"
+
+// Запись прямого индекса: слово документа и количество его вхождений в документ
+struct ForwardEntry
+{
+    TermId term_id;
+    uint32_t term_count;
+};
+
+// Записи прямого индекса одного документа, упорядоченные по возрастанию идентификаторов слов.
+// Действительны до изменения прямого индекса.
+class ForwardEntries
+{
+public:
+    ForwardEntries() = default;
+
+    ForwardEntries(const ForwardEntry* first, const ForwardEntry* last) : first_(first), last_(last)
+    {}
+
+    const ForwardEntry* begin() const
+    {
+        return first_;
+    }
+
+    const ForwardEntry* end() const
+    {
+        return last_;
+    }
+
+    size_t size() const
+    {
+        return last_ - first_;
+    }
+
+    bool empty() const
+    {
+        return first_ == last_;
+    }
+
+    // Первая запись с идентификатором слова не меньше term_id среди записей, начиная с from. Шаг поиска
+    // удваивается, пока не перешагнёт искомое слово, поэтому поиск занимает O(log d), где d - расстояние
+    // до найденной записи: последовательный поиск возрастающих слов короткого запроса в длинном документе
+    // обходится дешевле слияния, а для длинного запроса - не дороже его.
+    const ForwardEntry* SeekTerm(const ForwardEntry* from, TermId term_id) const;
+
+private:
+    const ForwardEntry *first_ = nullptr;
+    const ForwardEntry *last_ = nullptr;
+};
+
+// Прямой индекс: для каждого документа - его слова с количествами вхождений. Записи всех документов лежат
+// подряд в общем массиве, выделенном из ресурса памяти, документы адресуются порядковыми номерами.
+// Место удалённых документов возвращается уплотнением массива, которое выполняется автоматически,
+// когда записи удалённых документов составляют не меньше половины массива.
+class ForwardIndex
+{
+public:
+    // Ресурс памяти должен существовать дольше индекса
+    explicit ForwardIndex(std::pmr::memory_resource* memory_resource = std::pmr::get_default_resource())
+        : entries_(memory_resource)
+    {}
+
+    // Копия выделяет записи из того же ресурса памяти, что и исходный индекс
+    ForwardIndex(const ForwardIndex& other)
+        : entries_(other.entries_, other.entries_.get_allocator()), documents_(other.documents_),
+          dead_entry_count_(other.dead_entry_count_)
+    {}
+
+    ForwardIndex& operator=(const ForwardIndex&) = default;
+    ForwardIndex(ForwardIndex&&) = default;
+    ForwardIndex& operator=(ForwardIndex&&) = default;
+
+    // Добавляет документ с очередным порядковым номером; записи упорядочиваются по идентификаторам слов
+    void AddDocument(const std::vector<ForwardEntry>& entries);
+    void RemoveDocument(int ordinal);
+    // Перенумеровывает документы: документ ordinal получает номер new_ordinals[ordinal], а при отрицательном
+    // номере исключается из индекса (его записи уже должны быть удалены RemoveDocument). Новые номера идут
+    // подряд с нуля в порядке прежних. Массив записей при этом уплотняется.
+    void RenumberDocuments(const std::vector<int>& new_ordinals);
+
+    ForwardEntries GetDocument(int ordinal) const
+    {
+        const DocumentEntries& document = documents_[ordinal];
+        return {entries_.data() + document.offset, entries_.data() + document.offset + document.size};
+    }
+
+    // Количество записей действующих документов
+    size_t GetEntryCount() const
+    {
+        return entries_.size() - dead_entry_count_;
+    }
+
+private:
+    // Отрезок записей документа в общем массиве
+    struct DocumentEntries
+    {
+        uint64_t offset;
+        uint32_t size;
+    };
+
+    static constexpr size_t MIN_COMPACTION_DEAD_ENTRY_COUNT = 64 * 1024;
+
+    std::pmr::vector<ForwardEntry> entries_;
+    std::vector<DocumentEntries> documents_; // Отрезки записей по порядковым номерам документов
+    size_t dead_entry_count_ = 0; // Количество записей удалённых документов, ещё занимающих место в массиве
+
+    void Compact();
+};
+
+// Слова документа и их частоты в документе, вычисляемые по записям прямого индекса при обходе.
+// Слова перечисляются в порядке возрастания их идентификаторов. Действительны до изменения индекса.
+class WordFrequencies
+{
+public:
+    class iterator
+    {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = std::pair<std::string_view, double>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = value_type;
+
+        iterator(const TermDictionary* words, const ForwardEntry* entry, uint32_t document_length)
+            : words_(words), entry_(entry), document_length_(document_length)
+        {}
+
+        value_type operator*() const
+        {
+            return {words_->GetTerm(entry_->term_id), entry_->term_count / static_cast<double>(document_length_)};
+        }
+
+        iterator& operator++()
+        {
+            ++entry_;
+            return *this;
+        }
+
+        iterator operator++(int)
+        {
+            iterator previous = *this;
+            ++entry_;
+            return previous;
+        }
+
+        bool operator==(const iterator& other) const
+        {
+            return entry_ == other.entry_;
+        }
+
+        bool operator!=(const iterator& other) const
+        {
+            return entry_ != other.entry_;
+        }
+
+    private:
+        const TermDictionary *words_;
+        const ForwardEntry *entry_;
+        uint32_t document_length_;
+    };
+
+    WordFrequencies() = default;
+
+    WordFrequencies(const TermDictionary& words, ForwardEntries entries, uint32_t document_length)
+        : words_(&words), entries_(entries), document_length_(document_length)
+    {}
+
+    iterator begin() const
+    {
+        return {words_, entries_.begin(), document_length_};
+    }
+
+    iterator end() const
+    {
+        return {words_, entries_.end(), document_length_};
+    }
+
+    size_t size() const
+    {
+        return entries_.size();
+    }
+
+    bool empty() const
+    {
+        return entries_.empty();
+    }
+
+private:
+    const TermDictionary *words_ = nullptr;
+    ForwardEntries entries_;
+    uint32_t document_length_ = 0;
+};
@@ -0,0 +1,204 @@
+#include <filesystem>
+#include <stdexcept>
+#include <system_error>
+#include "index_snapshot.h"
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+bool IsLittleEndianHost()
+{
+    const uint16_t probe = 1;
+    return *reinterpret_cast<const unsigned char*>(&probe) == 1;
+}
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const string& path)
+{
+    HANDLE file_handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                     FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file_handle == INVALID_HANDLE_VALUE)
+        throw runtime_error("Снимок индекса : не удалось открыть файл "s + path);
+    file_handle_ = file_handle;
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file_handle, &file_size))
+    {
+        CloseHandle(file_handle);
+        throw runtime_error("Снимок индекса : не удалось определить размер файла "s + path);
+    }
+    size_ = static_cast<size_t>(file_size.QuadPart);
+    if (size_ == 0)
+        return;
+    mapping_handle_ = CreateFileMappingA(file_handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping_handle_)
+        data_ = static_cast<const char*>(MapViewOfFile(mapping_handle_, FILE_MAP_READ, 0, 0, 0));
+    if (!data_)
+    {
+        if (mapping_handle_)
+            CloseHandle(mapping_handle_);
+        CloseHandle(file_handle);
+        throw runtime_error("Снимок индекса : не удалось отобразить файл в память "s + path);
+    }
+}
+
+MappedFile::~MappedFile()
+{
+    if (data_)
+        UnmapViewOfFile(data_);
+    if (mapping_handle_)
+        CloseHandle(mapping_handle_);
+    CloseHandle(file_handle_);
+}
+
+#else
+
+MappedFile::MappedFile(const string& path)
+{
+    const int file_descriptor = open(path.c_str(), O_RDONLY);
+    if (file_descriptor < 0)
+        throw runtime_error("Снимок индекса : не удалось открыть файл "s + path);
+    struct stat file_stat;
+    if (fstat(file_descriptor, &file_stat) != 0)
+    {
+        close(file_descriptor);
+        throw runtime_error("Снимок индекса : не удалось определить размер файла "s + path);
+    }
+    size_ = static_cast<size_t>(file_stat.st_size);
+    if (size_ > 0)
+    {
+        void *mapping = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, file_descriptor, 0);
+        if (mapping == MAP_FAILED)
+        {
+            close(file_descriptor);
+            throw runtime_error("Снимок индекса : не удалось отобразить файл в память "s + path);
+        }
+        madvise(mapping, size_, MADV_SEQUENTIAL);
+        data_ = static_cast<const char*>(mapping);
+    }
+    // Отображение остаётся действительным и после закрытия дескриптора
+    close(file_descriptor);
+}
+
+MappedFile::~MappedFile()
+{
+    if (data_)
+        munmap(const_cast<char*>(data_), size_);
+}
+
+#endif
+
+SnapshotWriter::SnapshotWriter(const string& path)
+    : path_(path), temp_path_(path + ".tmp"s), out_(temp_path_, ios::binary | ios::trunc)
+{
+    if (!out_)
+        throw runtime_error("Снимок индекса : не удалось создать файл "s + temp_path_);
+}
+
+SnapshotWriter::~SnapshotWriter()
+{
+    if (is_finished_)
+        return;
+    out_.close();
+    error_code error;
+    filesystem::remove(temp_path_, error);
+}
+
+void SnapshotWriter::WriteStrings(const vector<string_view>& strings)
+{
+    vector<uint64_t> offsets;
+    offsets.reserve(strings.size() + 1);
+    uint64_t offset = 0;
+    for (const string_view str : strings)
+    {
+        offsets.push_back(offset);
+        offset += str.size();
+    }
+    offsets.push_back(offset);
+
+    Write<uint64_t>(strings.size());
+    WriteArray(offsets);
+    Align();
+    for (const string_view str : strings)
+        WriteBytes(str.data(), str.size());
+}
+
+void SnapshotWriter::Finish()
+{
+    out_.flush();
+    out_.close();
+    if (!out_)
+        throw runtime_error("Снимок индекса : ошибка записи файла "s + temp_path_);
+    // Переименование заменяет прежний снимок целиком
+    error_code error;
+    filesystem::rename(temp_path_, path_, error);
+    if (error)
+        throw runtime_error("Снимок индекса : не удалось заменить файл "s + path_ + " : "s + error.message());
+    is_finished_ = true;
+}
+
+void SnapshotWriter::WriteBytes(const void* bytes, size_t count)
+{
+    out_.write(static_cast<const char*>(bytes), count);
+    position_ += count;
+}
+
+void SnapshotWriter::Align()
+{
+    static const char padding[SNAPSHOT_ALIGNMENT] = {};
+    if (position_ % SNAPSHOT_ALIGNMENT)
+        WriteBytes(padding, SNAPSHOT_ALIGNMENT - position_ % SNAPSHOT_ALIGNMENT);
+}
+
+SnapshotReader::SnapshotReader(const MappedFile& file) : file_(file)
+{}
+
+vector<string_view> SnapshotReader::ReadStrings()
+{
+    const uint64_t string_count = Read<uint64_t>();
+    CheckAvailable(sizeof(uint64_t), string_count);
+    const vector<uint64_t> offsets = ReadArray<uint64_t>(string_count + 1);
+    Align();
+    const uint64_t total_size = offsets.back();
+    const char *characters = TakeBytes(total_size);
+
+    vector<string_view> strings;
+    strings.reserve(string_count);
+    for (size_t i = 0; i < string_count; ++i)
+    {
+        if (offsets[i] > offsets[i + 1] || offsets[i + 1] > total_size)
+            throw invalid_argument("Снимок индекса : повреждён набор строк"s);
+        strings.push_back({characters + offsets[i], static_cast<size_t>(offsets[i + 1] - offsets[i])});
+    }
+    return strings;
+}
+
+void SnapshotReader::CheckAvailable(size_t element_size, size_t count) const
+{
+    const size_t available = file_.size() - min(file_.size(), position_);
+    if (count > available / element_size)
+        throw invalid_argument("Снимок индекса : файл усечён или повреждён"s);
+}
+
+const char* SnapshotReader::TakeBytes(size_t count)
+{
+    CheckAvailable(1, count);
+    const char *bytes = file_.data() + position_;
+    position_ += count;
+    return bytes;
+}
+
+void SnapshotReader::Align()
+{
+    if (position_ % SNAPSHOT_ALIGNMENT)
+        position_ += SNAPSHOT_ALIGNMENT - position_ % SNAPSHOT_ALIGNMENT;
+}
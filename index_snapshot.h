@@ -0,0 +1,163 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Низкоуровневые средства чтения и записи двоичного снимка индекса.
+// Снимок - последовательность скалярных полей и массивов в порядке байтов little-endian. Каждый массив
+// начинается со смещения, кратного SNAPSHOT_ALIGNMENT, так что при отображении файла в память массивы
+// оказываются выровненными. Массивы копируются из отображения (см. SnapshotReader::ReadArray): индекс
+// после загрузки изменяем и владеет своими данными.
+
+static constexpr char SNAPSHOT_MAGIC[8] = {'H', 'O', 'L', 'M', 'E', 'S', 'I', 'X'};
+static constexpr uint32_t SNAPSHOT_VERSION = 2;
+static constexpr size_t SNAPSHOT_ALIGNMENT = 8;
+
+bool IsLittleEndianHost();
+
+// Отображение файла в память только для чтения
+class MappedFile
+{
+public:
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* data() const
+    {
+        return data_;
+    }
+
+    size_t size() const
+    {
+        return size_;
+    }
+
+private:
+    const char *data_ = nullptr;
+    size_t size_ = 0;
+#ifdef _WIN32
+    void *file_handle_ = nullptr;
+    void *mapping_handle_ = nullptr;
+#endif
+};
+
+// Снимок пишется во временный файл path + ".tmp", который заменяет файл path только после успешного
+// завершения записи (см. Finish), так что сбой посреди записи не портит прежний снимок
+class SnapshotWriter
+{
+public:
+    explicit SnapshotWriter(const std::string& path);
+    // Незавершённая запись удаляет временный файл
+    ~SnapshotWriter();
+    SnapshotWriter(const SnapshotWriter&) = delete;
+    SnapshotWriter& operator=(const SnapshotWriter&) = delete;
+
+    template <typename T>
+    void Write(T value)
+    {
+        WriteArray(&value, 1);
+    }
+
+    template <typename T>
+    void WriteArray(const T* values, size_t count)
+    {
+        static_assert(std::is_arithmetic_v<T>, "Снимок индекса содержит только массивы чисел");
+        Align();
+        if (IsLittleEndianHost() || sizeof(T) == 1)
+        {
+            WriteBytes(values, sizeof(T) * count);
+            return;
+        }
+        for (size_t i = 0; i < count; ++i)
+        {
+            char bytes[sizeof(T)];
+            std::memcpy(bytes, &values[i], sizeof(T));
+            for (size_t j = 0; j < sizeof(T) / 2; ++j)
+                std::swap(bytes[j], bytes[sizeof(T) - 1 - j]);
+            WriteBytes(bytes, sizeof(T));
+        }
+    }
+
+    template <typename T>
+    void WriteArray(const std::vector<T>& values)
+    {
+        WriteArray(values.data(), values.size());
+    }
+
+    // Записывает набор строк: количество, массив смещений и общий массив символов
+    void WriteStrings(const std::vector<std::string_view>& strings);
+    // Завершает запись и переименовывает временный файл в path, выбрасывает исключение при ошибке вывода
+    void Finish();
+
+private:
+    std::string path_;
+    std::string temp_path_;
+    std::ofstream out_;
+    bool is_finished_ = false;
+    size_t position_ = 0;
+
+    void WriteBytes(const void* bytes, size_t count);
+    void Align();
+};
+
+class SnapshotReader
+{
+public:
+    explicit SnapshotReader(const MappedFile& file);
+
+    template <typename T>
+    T Read()
+    {
+        T value;
+        ReadArray(&value, 1);
+        return value;
+    }
+
+    template <typename T>
+    void ReadArray(T* values, size_t count)
+    {
+        static_assert(std::is_arithmetic_v<T>, "Снимок индекса содержит только массивы чисел");
+        Align();
+        const char *bytes = TakeBytes(sizeof(T) * count);
+        // У пустого массива values может быть нулевым, а memcpy с нулевым указателем не определён даже для 0 байт
+        if (count == 0)
+            return;
+        std::memcpy(values, bytes, sizeof(T) * count);
+        if (!IsLittleEndianHost() && sizeof(T) > 1)
+            for (size_t i = 0; i < count; ++i)
+            {
+                char *value_bytes = reinterpret_cast<char*>(&values[i]);
+                for (size_t j = 0; j < sizeof(T) / 2; ++j)
+                    std::swap(value_bytes[j], value_bytes[sizeof(T) - 1 - j]);
+            }
+    }
+
+    template <typename T>
+    std::vector<T> ReadArray(size_t count)
+    {
+        CheckAvailable(sizeof(T), count);
+        std::vector<T> values(count);
+        ReadArray(values.data(), count);
+        return values;
+    }
+
+    // Читает набор строк, записанный SnapshotWriter::WriteStrings. Строки указывают в отображённый файл.
+    std::vector<std::string_view> ReadStrings();
+    // Проверяет, что в файле осталось не меньше count элементов размера element_size
+    void CheckAvailable(size_t element_size, size_t count) const;
+
+private:
+    const MappedFile& file_;
+    size_t position_ = 0;
+
+    const char* TakeBytes(size_t count);
+    void Align();
+};
@@ -1,10 +1,17 @@
 
+#include "data_generator.h"
 #include "process_queries.h"
 #include "search_server.h"
 #include "log_duration.h"
 
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
 #include <iostream>
+#include <map>
 #include <random>
+#include <set>
+#include <sstream>
 #include <string>
 #include <vector>
 
@@ -12,48 +19,6 @@ using namespace std;
 
 #define TEST(processor) Test(#processor, processor, test_search_server, test_queries)
 
-string GenerateWord(mt19937& generator, int max_length) {
-    const int length = uniform_int_distribution(1, max_length)(generator);
-    string word;
-    word.reserve(length);
-    for (int i = 0; i < length; ++i) {
-        word.push_back(uniform_int_distribution('a', 'z')(generator));
-    }
-    return word;
-}
-
-vector<string> GenerateDictionary(mt19937& generator, int word_count, int max_length) {
-    vector<string> words;
-    words.reserve(word_count);
-    for (int i = 0; i < word_count; ++i) {
-        words.push_back(GenerateWord(generator, max_length));
-    }
-    sort(words.begin(), words.end());
-    words.erase(unique(words.begin(), words.end()), words.end());
-    return words;
-}
-
-string GenerateQuery(mt19937& generator, const vector<string>& dictionary, int max_word_count) {
-    const int word_count = uniform_int_distribution(1, max_word_count)(generator);
-    string query;
-    for (int i = 0; i < word_count; ++i) {
-        if (!query.empty()) {
-            query.push_back(' ');
-        }
-        query += dictionary[uniform_int_distribution<int>(0, dictionary.size() - 1)(generator)];
-    }
-    return query;
-}
-
-vector<string> GenerateQueries(mt19937& generator, const vector<string>& dictionary, int query_count, int max_word_count) {
-    vector<string> queries;
-    queries.reserve(query_count);
-    for (int i = 0; i < query_count; ++i) {
-        queries.push_back(GenerateQuery(generator, dictionary, max_word_count));
-    }
-    return queries;
-}
-
 template <typename QueriesProcessor>
 void Test(string_view mark, QueriesProcessor processor, const SearchServer& search_server, const vector<string>& queries) {
     LOG_DURATION(mark);
@@ -82,6 +47,394 @@ void PrintDocument(const Document& document)
          << "rating = "s << document.rating << " }"s << endl;
 }
 
+// Эталонный индекс для проверки SearchServer: хранит слова документов как есть и на каждый запрос
+// перебирает все документы, вычисляя TF-IDF по определению
+class ReferenceIndex
+{
+public:
+    explicit ReferenceIndex(const string& stop_words_text)
+    {
+        for (const string& word : SplitText(stop_words_text))
+            stop_words_.insert(word);
+    }
+
+    void AddDocument(int document_id, const string& text, DocumentStatus status, const vector<int>& ratings)
+    {
+        ReferenceDocument& document = documents_[document_id];
+        document = {};
+        for (const string& word : SplitText(text))
+            if (!stop_words_.count(word))
+            {
+                ++document.word_counts[word];
+                ++document.length;
+            }
+        document.status = status;
+        int rating_sum = 0;
+        for (const int rating : ratings)
+            rating_sum += rating;
+        document.rating = ratings.empty() ? 0 : rating_sum / static_cast<int>(ratings.size());
+    }
+
+    void RemoveDocument(int document_id)
+    {
+        documents_.erase(document_id);
+    }
+
+    vector<Document> FindTopDocuments(const string& raw_query, DocumentStatus status, size_t result_count) const
+    {
+        set<string> plus_words;
+        set<string> minus_words;
+        for (const string& word : SplitText(raw_query))
+        {
+            if (word[0] == '-')
+            {
+                if (!stop_words_.count(word.substr(1)))
+                    minus_words.insert(word.substr(1));
+            }
+            else if (!stop_words_.count(word))
+                plus_words.insert(word);
+        }
+
+        map<string, double> inverse_document_freqs;
+        for (const string& word : plus_words)
+        {
+            int document_freq = 0;
+            for (const auto& [_, document] : documents_)
+                document_freq += document.word_counts.count(word);
+            if (document_freq > 0)
+                inverse_document_freqs[word] = log(documents_.size() * 1.0 / document_freq);
+        }
+
+        vector<Document> documents;
+        for (const auto& [document_id, document] : documents_)
+        {
+            if (document.status != status)
+                continue;
+            bool is_minus_word = false;
+            for (const string& word : minus_words)
+                is_minus_word = is_minus_word || document.word_counts.count(word);
+            if (is_minus_word)
+                continue;
+            bool is_matched = false;
+            double relevance = 0;
+            for (const auto& [word, inverse_document_freq] : inverse_document_freqs)
+                if (const auto word_it = document.word_counts.find(word); word_it != document.word_counts.end())
+                {
+                    is_matched = true;
+                    relevance += word_it->second * 1.0 / document.length * inverse_document_freq;
+                }
+            if (is_matched)
+                documents.push_back(Document(document_id, relevance, document.rating));
+        }
+        sort(documents.begin(), documents.end(), IsMoreRelevant);
+        if (documents.size() > result_count)
+            documents.resize(result_count);
+        return documents;
+    }
+
+    // Порядок выдачи SearchServer: по убыванию релевантности, при равной с точностью 1e-6 - по убыванию
+    // рейтинга, затем по возрастанию индекса
+    static bool IsMoreRelevant(const Document& lhs, const Document& rhs)
+    {
+        if (abs(lhs.relevance - rhs.relevance) < 1e-6)
+        {
+            if (lhs.rating != rhs.rating)
+                return lhs.rating > rhs.rating;
+            return lhs.id < rhs.id;
+        }
+        return lhs.relevance > rhs.relevance;
+    }
+
+private:
+    struct ReferenceDocument
+    {
+        map<string, int> word_counts;
+        int length = 0;
+        DocumentStatus status = DocumentStatus::ACTUAL;
+        int rating = 0;
+    };
+
+    set<string> stop_words_;
+    map<int, ReferenceDocument> documents_;
+
+    static vector<string> SplitText(const string& text)
+    {
+        istringstream stream(text);
+        vector<string> words;
+        for (string word; stream >> word;)
+            words.push_back(word);
+        return words;
+    }
+};
+
+// Сравнивает выдачу сервера с ожидаемой; при расхождении печатает запрос и обе выдачи
+bool CheckDocuments(string_view mark, const string& query, const vector<Document>& documents,
+                    const vector<Document>& expected_documents)
+{
+    bool is_equal = documents.size() == expected_documents.size();
+    for (size_t i = 0; i < documents.size() && is_equal; ++i)
+        is_equal = documents[i].id == expected_documents[i].id && documents[i].rating == expected_documents[i].rating &&
+                   abs(documents[i].relevance - expected_documents[i].relevance) < 1e-9;
+    if (is_equal)
+        return true;
+    cout << mark << " : query ["s << query << "] mismatch"s << endl;
+    for (const Document& document : documents)
+        PrintDocument(document);
+    cout << "expected:"s << endl;
+    for (const Document& document : expected_documents)
+        PrintDocument(document);
+    return false;
+}
+
+// Документ проверочного корпуса: индекс, текст, статус и оценки
+struct TestDocument
+{
+    int id;
+    string text;
+    DocumentStatus status;
+    vector<int> ratings;
+};
+
+vector<TestDocument> GenerateTestDocuments(mt19937& generator, const vector<string>& dictionary, int first_id,
+                                           int document_count, int max_word_count)
+{
+    const DocumentStatus statuses[] = {DocumentStatus::ACTUAL, DocumentStatus::IRRELEVANT, DocumentStatus::BANNED};
+    vector<TestDocument> documents;
+    for (int i = 0; i < document_count; ++i)
+    {
+        vector<int> ratings(uniform_int_distribution(0, 3)(generator));
+        for (int& rating : ratings)
+            rating = uniform_int_distribution(-10, 10)(generator);
+        documents.push_back({first_id + i, GenerateQuery(generator, dictionary, max_word_count),
+                             statuses[uniform_int_distribution(0, 2)(generator)], ratings});
+    }
+    return documents;
+}
+
+void AddTestDocuments(SearchServer& search_server, ReferenceIndex& reference, const vector<TestDocument>& documents)
+{
+    for (const TestDocument& document : documents)
+    {
+        search_server.AddDocument(document.id, document.text, document.status, document.ratings);
+        reference.AddDocument(document.id, document.text, document.status, document.ratings);
+    }
+}
+
+// Запросы из 1-5 слов словаря, примерно каждое пятое слово - минус-слово
+vector<string> GenerateTestQueries(mt19937& generator, const vector<string>& dictionary, int query_count)
+{
+    vector<string> queries;
+    for (int i = 0; i < query_count; ++i)
+    {
+        string query;
+        for (int word_count = uniform_int_distribution(1, 5)(generator); word_count > 0; --word_count)
+        {
+            if (!query.empty())
+                query.push_back(' ');
+            if (uniform_int_distribution(0, 4)(generator) == 0)
+                query.push_back('-');
+            query += dictionary[uniform_int_distribution<size_t>(0, dictionary.size() - 1)(generator)];
+        }
+        queries.push_back(query);
+    }
+    return queries;
+}
+
+// Сравнивает выдачу сервера по всем запросам и статусам с эталонной, последовательно и параллельно
+bool CheckAgainstReference(string_view mark, const SearchServer& search_server, const ReferenceIndex& reference,
+                           const vector<string>& queries)
+{
+    const size_t result_count = search_server.GetSetResultDocumentCount(0);
+    bool is_ok = true;
+    for (const string& query : queries)
+        for (const DocumentStatus status : {DocumentStatus::ACTUAL, DocumentStatus::BANNED})
+        {
+            const vector<Document> expected_documents = reference.FindTopDocuments(query, status, result_count);
+            is_ok = CheckDocuments(mark, query, search_server.FindTopDocuments(execution::seq, query, status),
+                                   expected_documents) && is_ok;
+            is_ok = CheckDocuments(mark, query, search_server.FindTopDocuments(execution::par, query, status),
+                                   expected_documents) && is_ok;
+        }
+    return is_ok;
+}
+
+// Отбор лучших документов с отсечением по MaxScore должен давать ту же выдачу, что и полный перебор,
+// при любом размере выдачи
+bool TestTopDocumentsAgainstReference()
+{
+    mt19937 generator(3);
+    const auto dictionary = GenerateDictionary(generator, 150, 6);
+    SearchServer search_server(dictionary[0]);
+    ReferenceIndex reference(dictionary[0]);
+    AddTestDocuments(search_server, reference, GenerateTestDocuments(generator, dictionary, 0, 6000, 30));
+    const vector<string> queries = GenerateTestQueries(generator, dictionary, 100);
+
+    bool is_ok = true;
+    const int default_result_count = search_server.GetSetResultDocumentCount(0);
+    for (const int result_count : {1, 5, 40})
+    {
+        search_server.GetSetResultDocumentCount(result_count);
+        is_ok = CheckAgainstReference("Top documents"sv, search_server, reference, queries) && is_ok;
+    }
+    search_server.GetSetResultDocumentCount(default_result_count);
+    return is_ok;
+}
+
+// Логически удалённые документы не должны попадать в выдачу и учитываться в обратной частоте слов
+// ни до уплотнения индекса, ни после него; индексы удалённых документов можно занимать снова
+bool TestDeferredRemovalAgainstReference()
+{
+    mt19937 generator(6);
+    const auto dictionary = GenerateDictionary(generator, 150, 6);
+    SearchServer search_server(dictionary[0]);
+    ReferenceIndex reference(dictionary[0]);
+    search_server.SetRemovalMode(RemovalMode::DEFERRED);
+    AddTestDocuments(search_server, reference, GenerateTestDocuments(generator, dictionary, 0, 3000, 30));
+    const vector<string> queries = GenerateTestQueries(generator, dictionary, 50);
+
+    vector<int> document_ids(search_server.begin(), search_server.end());
+    shuffle(document_ids.begin(), document_ids.end(), generator);
+    bool is_ok = true;
+    for (int round = 0; round < 4; ++round)
+    {
+        vector<int> removed_document_ids;
+        for (int i = 0; i < 300; ++i)
+        {
+            if (i % 2 == 0)
+                search_server.RemoveDocument(document_ids.back());
+            else
+                search_server.RemoveDocument(execution::par, document_ids.back());
+            reference.RemoveDocument(document_ids.back());
+            removed_document_ids.push_back(document_ids.back());
+            document_ids.pop_back();
+        }
+        if (search_server.GetPendingRemovalCount() == 0)
+        {
+            cout << "Deferred removal : no pending removals after round "s << round << endl;
+            is_ok = false;
+        }
+        is_ok = CheckAgainstReference("Deferred removal"sv, search_server, reference, queries) && is_ok;
+
+        // Индексы только что удалённых документов занимаются новыми документами до уплотнения
+        vector<TestDocument> documents = GenerateTestDocuments(generator, dictionary, 0, 50, 30);
+        for (size_t i = 0; i < documents.size(); ++i)
+        {
+            documents[i].id = removed_document_ids[i];
+            document_ids.insert(document_ids.begin(), documents[i].id);
+        }
+        AddTestDocuments(search_server, reference, documents);
+        is_ok = CheckAgainstReference("Deferred removal"sv, search_server, reference, queries) && is_ok;
+        if (round % 2 == 1)
+        {
+            if (round == 1)
+                search_server.CompactIndex();
+            else
+                search_server.CompactIndex(execution::par);
+            is_ok = search_server.GetPendingRemovalCount() == 0 && is_ok;
+            is_ok = CheckAgainstReference("Deferred removal, compacted"sv, search_server, reference, queries) && is_ok;
+        }
+    }
+    return is_ok;
+}
+
+// Удаление из сжатых списков вхождений, немедленное и с уплотнением, должно давать ту же выдачу, что и эталон;
+// переключение сжатия выдачу не меняет
+bool TestCompressedRemovalAgainstReference()
+{
+    mt19937 generator(8);
+    const auto dictionary = GenerateDictionary(generator, 150, 6);
+    SearchServer search_server(dictionary[0]);
+    ReferenceIndex reference(dictionary[0]);
+    search_server.SetPostingCompression(true);
+    AddTestDocuments(search_server, reference, GenerateTestDocuments(generator, dictionary, 0, 4000, 30));
+    const vector<string> queries = GenerateTestQueries(generator, dictionary, 50);
+
+    vector<int> document_ids(search_server.begin(), search_server.end());
+    shuffle(document_ids.begin(), document_ids.end(), generator);
+    const auto remove_documents = [&](int document_count)
+                                  {
+                                      for (int i = 0; i < document_count; ++i)
+                                      {
+                                          if (i % 2 == 0)
+                                              search_server.RemoveDocument(document_ids.back());
+                                          else
+                                              search_server.RemoveDocument(execution::par, document_ids.back());
+                                          reference.RemoveDocument(document_ids.back());
+                                          document_ids.pop_back();
+                                      }
+                                  };
+
+    // Немедленное удаление; на втором круге срабатывает перенумерация документов
+    bool is_ok = true;
+    for (int round = 0; round < 2; ++round)
+    {
+        remove_documents(1000);
+        is_ok = CheckAgainstReference("Compressed removal"sv, search_server, reference, queries) && is_ok;
+    }
+    search_server.SetPostingCompression(execution::par, false);
+    is_ok = CheckAgainstReference("Compressed removal, uncompressed"sv, search_server, reference, queries) && is_ok;
+    search_server.SetPostingCompression(true);
+    AddTestDocuments(search_server, reference, GenerateTestDocuments(generator, dictionary, 4000, 2000, 30));
+    for (int document_id = 4000; document_id < 6000; ++document_id)
+        document_ids.insert(document_ids.begin(), document_id);
+
+    // Отложенное удаление с вычёркиванием из сжатых списков при уплотнении
+    search_server.SetRemovalMode(RemovalMode::DEFERRED);
+    remove_documents(500);
+    is_ok = CheckAgainstReference("Compressed removal, deferred"sv, search_server, reference, queries) && is_ok;
+    search_server.CompactIndex(execution::par);
+    is_ok = CheckAgainstReference("Compressed removal, compacted"sv, search_server, reference, queries) && is_ok;
+    return is_ok;
+}
+
+// Индекс, загруженный из снимка, должен давать ту же выдачу, что и сохранённый, и оставаться изменяемым;
+// логически удалённые документы в снимок не попадают
+bool TestSnapshotRoundTrip()
+{
+    mt19937 generator(7);
+    const auto dictionary = GenerateDictionary(generator, 150, 6);
+    SearchServer search_server(dictionary[0]);
+    ReferenceIndex reference(dictionary[0]);
+    search_server.SetRemovalMode(RemovalMode::DEFERRED);
+    AddTestDocuments(search_server, reference, GenerateTestDocuments(generator, dictionary, 0, 2000, 30));
+    for (int document_id = 0; document_id < 2000; document_id += 7)
+    {
+        search_server.RemoveDocument(document_id);
+        reference.RemoveDocument(document_id);
+    }
+    const vector<string> queries = GenerateTestQueries(generator, dictionary, 50);
+    const string snapshot_path = (filesystem::temp_directory_path() / "holmes_search_test.snapshot"s).string();
+    search_server.SaveSnapshot(snapshot_path);
+
+    SearchServer loaded_server("stop"s);
+    loaded_server.LoadSnapshot(snapshot_path);
+    bool is_ok = loaded_server.GetDocumentCount() == search_server.GetDocumentCount();
+    is_ok = CheckAgainstReference("Snapshot"sv, loaded_server, reference, queries) && is_ok;
+    for (const string& query : queries)
+        is_ok = CheckDocuments("Snapshot"sv, query, loaded_server.FindTopDocuments(query),
+                               search_server.FindTopDocuments(query)) && is_ok;
+
+    // Загруженный индекс принимает новые документы и удаления
+    AddTestDocuments(loaded_server, reference, GenerateTestDocuments(generator, dictionary, 2000, 300, 30));
+    for (int document_id = 1; document_id < 2300; document_id += 11)
+    {
+        loaded_server.RemoveDocument(document_id);
+        reference.RemoveDocument(document_id);
+    }
+    is_ok = CheckAgainstReference("Snapshot, modified"sv, loaded_server, reference, queries) && is_ok;
+
+    // Снимок пустого индекса загружается в заполненный и опустошает его
+    SearchServer empty_server(dictionary[0]);
+    empty_server.SaveSnapshot(snapshot_path);
+    loaded_server.LoadSnapshot(snapshot_path);
+    is_ok = loaded_server.GetDocumentCount() == 0 && is_ok;
+    for (const string& query : queries)
+        is_ok = loaded_server.FindTopDocuments(query).empty() && is_ok;
+
+    filesystem::remove(snapshot_path);
+    return is_ok;
+}
+
 int main()
 {
     const vector<string> docs =
@@ -281,6 +634,18 @@ int main()
         TEST2("Parallel", par);
     }
 
-    return 0;
+    // Сверка с эталонным индексом
+    bool is_ok = true;
+    for (const auto& [name, test] : {pair{"Top documents"s, TestTopDocumentsAgainstReference},
+                                    pair{"Deferred removal"s, TestDeferredRemovalAgainstReference},
+                                    pair{"Snapshot"s, TestSnapshotRoundTrip},
+                                    pair{"Compressed removal"s, TestCompressedRemovalAgainstReference}})
+    {
+        const bool is_test_ok = test();
+        cout << name << ": "s << (is_test_ok ? "OK"s : "FAILED"s) << endl;
+        is_ok = is_ok && is_test_ok;
+    }
+
+    return is_ok ? 0 : 1;
 }
 
@@ -0,0 +1,38 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Битовая карта, адресуемая внутренним порядковым номером документа
+class OrdinalBitmap
+{
+public:
+    void Resize(size_t bit_count)
+    {
+        words_.resize((bit_count + WORD_BITS - 1) / WORD_BITS, 0);
+    }
+
+    void Set(size_t ordinal)
+    {
+        words_[ordinal / WORD_BITS] |= uint64_t(1) << (ordinal % WORD_BITS);
+    }
+
+    void Reset(size_t ordinal)
+    {
+        words_[ordinal / WORD_BITS] &= ~(uint64_t(1) << (ordinal % WORD_BITS));
+    }
+
+    bool Test(size_t ordinal) const
+    {
+        return (words_[ordinal / WORD_BITS] >> (ordinal % WORD_BITS)) & 1;
+    }
+
+    void Clear()
+    {
+        words_.assign(words_.size(), 0);
+    }
+
+private:
+    static constexpr size_t WORD_BITS = 64;
+    std::vector<uint64_t> words_;
+};
@@ -1,13 +1,10 @@
 #include <iostream>
 #include "paginator.h"
 
-std::ostream& operator<<(std::ostream& out, const PageDescriptor& page_descriptor)
+std::ostream& operator<<(std::ostream& out, const Document& document)
 {
-    for (const auto& curdoc : page_descriptor)
-    {
-        out << "{ document_id = " << curdoc.id ;
-        out << ", relevance = " << curdoc.relevance;
-        out << ", rating = " << curdoc.rating << " }";
-    }
+    out << "{ document_id = " << document.id;
+    out << ", relevance = " << document.relevance;
+    out << ", rating = " << document.rating << " }";
     return out;
 }
@@ -1,103 +1,196 @@
 #pragma once
+#include <algorithm>
+#include <cstddef>
 #include <iostream>
-#include <vector>
 #include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
 #include "document.h"
 
-using PageDescriptor = std::vector<Document>; // Список документов, относяшихся к странице
+// Страница - диапазон [begin, end) разбиваемой на страницы последовательности, элементы не копируются
+template <typename Iterator>
+class IteratorRange
+{
+public:
+    IteratorRange(Iterator range_begin, Iterator range_end) : begin_(range_begin), end_(range_end)
+    {}
+
+    Iterator begin() const
+    {
+        return begin_;
+    }
+
+    Iterator end() const
+    {
+        return end_;
+    }
+
+    size_t size() const
+    {
+        return std::distance(begin_, end_);
+    }
+
+private:
+    Iterator begin_;
+    Iterator end_;
+};
 
+// Разбиение последовательности на страницы по page_size элементов. Страницы вычисляются при обходе
+// и указывают в саму последовательность, поэтому она должна существовать, пока используются страницы.
+// Разбиение может само владеть последовательностью (owner), тогда страницы действительны, пока существует
+// разбиение или одна из его копий.
 template <typename Iterator>
 class Paginator
 {
 public:
-    class PageIterator : public std::iterator<std::bidirectional_iterator_tag, const PageDescriptor>
+    class PageIterator
     {
     public:
-        friend class Paginator;
-        PageIterator(const Paginator *pagin_p, int page_num) : pag_p(pagin_p)
-        {
-            if (page_num < 0)
-                current_page_number = 0;
-            else if (page_num >= static_cast<int>(pag_p->pages_descriptors_.size()))
-                current_page_number = pag_p->pages_descriptors_.size();
-            else
-                current_page_number = page_num;
-        }
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = IteratorRange<Iterator>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = value_type;
+
+        PageIterator(Iterator page_begin, Iterator result_begin, Iterator result_end, size_t page_size,
+                     size_t last_page_size)
+            : page_begin_(page_begin), page_end_(Advance(page_begin, result_end, page_size)),
+              result_begin_(result_begin), result_end_(result_end), page_size_(page_size),
+              last_page_size_(last_page_size)
+        {}
+
         PageIterator& operator++()
         {
-            if (current_page_number < static_cast<int>(pag_p->pages_descriptors_.size()))
-                ++current_page_number;
+            page_begin_ = page_end_;
+            page_end_ = Advance(page_end_, result_end_, page_size_);
             return *this;
         }
 
+        PageIterator operator++(int)
+        {
+            PageIterator previous = *this;
+            ++(*this);
+            return previous;
+        }
+
+        // Все страницы, кроме последней, полные, поэтому начало предыдущей страницы отстоит от начала
+        // текущей на page_size элементов, а начало последней - от конца последовательности на last_page_size.
+        // Перед первой страницей отступать некуда, поэтому на ней итератор остается на месте
         PageIterator& operator--()
         {
-            if (current_page_number > 0)
-                --current_page_number;
+            if (page_begin_ == result_begin_)
+                return *this;
+            page_end_ = page_begin_;
+            page_begin_ = std::prev(page_begin_, page_begin_ == result_end_ ? last_page_size_ : page_size_);
             return *this;
         }
 
-        const PageDescriptor& operator*() const
+        PageIterator operator--(int)
         {
-            return pag_p->pages_descriptors_.at(current_page_number);
+            PageIterator previous = *this;
+            --(*this);
+            return previous;
         }
 
-        bool operator==(const PageIterator& pag_it)
+        value_type operator*() const
         {
-            return pag_p == pag_it.pag_p && current_page_number == pag_it.current_page_number;
+            return {page_begin_, page_end_};
         }
 
-        bool operator!=(const PageIterator& pag_it)
+        bool operator==(const PageIterator& pag_it) const
+        {
+            return page_begin_ == pag_it.page_begin_;
+        }
+
+        bool operator!=(const PageIterator& pag_it) const
         {
             return !(*this == pag_it);
         }
+
     private:
-        const Paginator *pag_p;
-        int current_page_number;
+        Iterator page_begin_;
+        Iterator page_end_;
+        Iterator result_begin_;
+        Iterator result_end_;
+        size_t page_size_;
+        size_t last_page_size_;
     };
-    friend class PageIterator;
 
-    Paginator(Iterator& result_begin, Iterator& result_end, int page_size)
+    Paginator(Iterator result_begin, Iterator result_end, size_t page_size, std::shared_ptr<const void> owner = nullptr)
+        : owner_(std::move(owner)), result_begin_(result_begin), result_end_(result_end), page_size_(page_size)
     {
-        auto curdoc_it = result_begin;
-        while (curdoc_it != result_end)
-        {
-            PageDescriptor cur_page_desc;
-            for (int docs_in_page = 0; docs_in_page < page_size; ++docs_in_page)
-                if (curdoc_it != result_end)
-                {
-                    cur_page_desc.push_back(*curdoc_it);
-                    ++curdoc_it;
-                }
-                else
-                    break;
-            pages_descriptors_.push_back(cur_page_desc);
-        }
+        using std::operator""s;
+        if (page_size == 0)
+            throw std::invalid_argument("Разбиение на страницы : нулевой размер страницы"s);
+        const size_t result_size = std::distance(result_begin, result_end);
+        page_count_ = (result_size + page_size - 1) / page_size;
+        last_page_size_ = result_size - (page_count_ > 0 ? (page_count_ - 1) * page_size : 0);
     }
 
     PageIterator begin() const
     {
-        return {this, 0};
+        return {result_begin_, result_begin_, result_end_, page_size_, last_page_size_};
     }
 
     PageIterator end() const
     {
-        return {this, static_cast<int>(pages_descriptors_.size())};
+        return {result_end_, result_begin_, result_end_, page_size_, last_page_size_};
     }
 
-    unsigned size()
+    size_t size() const
     {
-        return pages_descriptors_.size();
+        return page_count_;
     }
+
 private:
-    // Вектор page_ содержит список описателей страниц типа PageDescriptor
-    std::vector<PageDescriptor> pages_descriptors_;
+    std::shared_ptr<const void> owner_; // Последовательность, которой владеет разбиение, либо nullptr
+    Iterator result_begin_;
+    Iterator result_end_;
+    size_t page_size_;
+    size_t page_count_;
+    size_t last_page_size_; // Размер последней, возможно неполной, страницы
+
+    // Итератор, отстоящий от first на count элементов, но не дальше last
+    static Iterator Advance(Iterator first, Iterator last, size_t count)
+    {
+        if constexpr (std::is_base_of_v<std::random_access_iterator_tag,
+                                        typename std::iterator_traits<Iterator>::iterator_category>)
+        {
+            return first + std::min<std::ptrdiff_t>(count, last - first);
+        }
+        else
+        {
+            for (; count > 0 && first != last; --count)
+                ++first;
+            return first;
+        }
+    }
 };
 
 template <typename Container>
 auto Paginate(const Container& c, size_t page_size)
 {
-    return Paginator(begin(c), end(c), page_size);
+    return Paginator(std::begin(c), std::end(c), page_size);
+}
+
+// Временный контейнер перемещается во владение разбиения, иначе он был бы уничтожен раньше,
+// чем прочитают указывающие в него страницы
+template <typename Container, typename = std::enable_if_t<!std::is_lvalue_reference_v<Container>>>
+auto Paginate(Container&& c, size_t page_size)
+{
+    const auto owner = std::make_shared<const std::remove_cv_t<Container>>(std::move(c));
+    return Paginator(std::begin(*owner), std::end(*owner), page_size, owner);
 }
 
-std::ostream& operator<<(std::ostream& out, const PageDescriptor& page_descriptor);
+std::ostream& operator<<(std::ostream& out, const Document& document);
+
+template <typename Iterator>
+std::ostream& operator<<(std::ostream& out, const IteratorRange<Iterator>& page)
+{
+    for (const auto& element : page)
+        out << element;
+    return out;
+}
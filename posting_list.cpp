@@ -0,0 +1,418 @@
+#include <algorithm>
+#include "posting_list.h"
+
+using namespace std;
+
+namespace
+{
+    void WriteVarint(vector<uint8_t>& bytes, uint32_t value)
+    {
+        while (value >= 0x80)
+        {
+            bytes.push_back(static_cast<uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        bytes.push_back(static_cast<uint8_t>(value));
+    }
+
+    uint32_t ReadVarint(const uint8_t*& bytes)
+    {
+        uint32_t value = *bytes & 0x7F;
+        for (int shift = 7; *bytes++ & 0x80; shift += 7)
+            value |= static_cast<uint32_t>(*bytes & 0x7F) << shift;
+        return value;
+    }
+
+    // Блок: разности идентификаторов с предыдущим документом (для первого - с base_document_id),
+    // затем количества вхождений
+    void WriteBlock(vector<uint8_t>& bytes, const int* document_ids, const uint32_t* term_counts, size_t entry_count,
+                    int base_document_id)
+    {
+        int previous_document_id = base_document_id;
+        for (size_t i = 0; i < entry_count; ++i)
+        {
+            WriteVarint(bytes, static_cast<uint32_t>(document_ids[i] - previous_document_id));
+            previous_document_id = document_ids[i];
+        }
+        for (size_t i = 0; i < entry_count; ++i)
+            WriteVarint(bytes, term_counts[i]);
+    }
+}
+
+PostingList::Cursor::Cursor(const PostingList& posting_list, int first_document_id, int last_document_id) :
+    posting_list_ptr_(&posting_list), last_document_id_(last_document_id)
+{
+    EnterChunk(0);
+    Settle();
+    SeekTo(first_document_id);
+}
+
+PostingList::Cursor::Cursor(const Cursor& other)
+{
+    *this = other;
+}
+
+PostingList::Cursor& PostingList::Cursor::operator=(const Cursor& other)
+{
+    posting_list_ptr_ = other.posting_list_ptr_;
+    last_document_id_ = other.last_document_id_;
+    block_index_ = other.block_index_;
+    document_ids_ptr_ = other.document_ids_ptr_;
+    term_counts_ptr_ = other.term_counts_ptr_;
+    chunk_size_ = other.chunk_size_;
+    position_ = other.position_;
+    document_id_ = other.document_id_;
+    // Декодированный блок лежит внутри самого курсора, поэтому при копировании его нужно перенести
+    if (other.document_ids_ptr_ == other.decoded_document_ids_)
+    {
+        copy(other.decoded_document_ids_, other.decoded_document_ids_ + chunk_size_, decoded_document_ids_);
+        copy(other.decoded_term_counts_, other.decoded_term_counts_ + chunk_size_, decoded_term_counts_);
+        document_ids_ptr_ = decoded_document_ids_;
+        term_counts_ptr_ = decoded_term_counts_;
+    }
+    return *this;
+}
+
+void PostingList::Cursor::SeekTo(int document_id)
+{
+    if (document_id_ >= document_id)
+        return;
+
+    const vector<BlockInfo>& blocks = posting_list_ptr_->blocks_;
+    if (block_index_ < blocks.size() && blocks[block_index_].last_document_id < document_id)
+    {
+        const auto block_it = lower_bound(blocks.begin() + block_index_ + 1, blocks.end(), document_id,
+                                          [](const BlockInfo& block, int target_document_id)
+                                          {
+                                              return block.last_document_id < target_document_id;
+                                          });
+        EnterChunk(block_it - blocks.begin());
+    }
+
+    // Шагами удваивающейся длины находим отрезок, содержащий искомую позицию, затем ищем в нём двоичным поиском
+    size_t position = position_;
+    if (position < chunk_size_ && document_ids_ptr_[position] < document_id)
+    {
+        size_t step = 1;
+        while (position + step < chunk_size_ && document_ids_ptr_[position + step] < document_id)
+        {
+            position += step;
+            step *= 2;
+        }
+        const int *first_ptr = document_ids_ptr_ + position + 1;
+        const int *last_ptr = document_ids_ptr_ + min(position + step, chunk_size_);
+        position = lower_bound(first_ptr, last_ptr, document_id) - document_ids_ptr_;
+    }
+    position_ = position;
+    Settle();
+}
+
+void PostingList::Cursor::Settle()
+{
+    while (position_ >= chunk_size_)
+    {
+        if (block_index_ >= posting_list_ptr_->blocks_.size())
+        {
+            document_id_ = NO_DOCUMENT;
+            return;
+        }
+        EnterChunk(block_index_ + 1);
+    }
+    SetDocumentId(document_ids_ptr_[position_]);
+}
+
+void PostingList::Cursor::EnterChunk(size_t block_index)
+{
+    block_index_ = block_index;
+    position_ = 0;
+    if (block_index < posting_list_ptr_->blocks_.size())
+    {
+        posting_list_ptr_->DecodeBlock(block_index, decoded_document_ids_, decoded_term_counts_);
+        document_ids_ptr_ = decoded_document_ids_;
+        term_counts_ptr_ = decoded_term_counts_;
+        chunk_size_ = posting_list_ptr_->blocks_[block_index].entry_count;
+    }
+    else
+    {
+        document_ids_ptr_ = posting_list_ptr_->document_ids_.data();
+        term_counts_ptr_ = posting_list_ptr_->term_counts_.data();
+        chunk_size_ = posting_list_ptr_->document_ids_.size();
+    }
+}
+
+PostingList::PostingList(bool is_compressed) : is_compressed_(is_compressed)
+{}
+
+void PostingList::Add(int document_id, uint32_t term_count, uint32_t document_length)
+{
+    // Документы, как правило, добавляются в порядке возрастания идентификаторов, и тогда их достаточно
+    // дописать в хвост. Вставка в середину требует распаковки сжатой части.
+    if (empty() || GetLastDocumentId() < document_id)
+    {
+        document_ids_.push_back(document_id);
+        term_counts_.push_back(term_count);
+        UpdateMaxTermFreq(term_count, document_length);
+        if (is_compressed_ && document_ids_.size() >= BLOCK_SIZE)
+            EncodeTail();
+        return;
+    }
+
+    DecodeAll();
+    const size_t position = lower_bound(document_ids_.begin(), document_ids_.end(), document_id) - document_ids_.begin();
+    if (document_ids_[position] == document_id)
+    {
+        term_counts_[position] += term_count;
+    }
+    else
+    {
+        document_ids_.insert(document_ids_.begin() + position, document_id);
+        term_counts_.insert(term_counts_.begin() + position, term_count);
+    }
+    UpdateMaxTermFreq(term_counts_[position], document_length);
+    if (is_compressed_)
+        EncodeTail();
+}
+
+bool PostingList::Erase(int document_id)
+{
+    // Блок документа находится по последним идентификаторам блоков; остальные блоки не меняются
+    const size_t block_index = lower_bound(blocks_.begin(), blocks_.end(), document_id,
+                                           [](const BlockInfo& block, int document_id)
+                                           {
+                                               return block.last_document_id < document_id;
+                                           }) - blocks_.begin();
+    if (block_index == blocks_.size())
+    {
+        const size_t position = lower_bound(document_ids_.begin(), document_ids_.end(), document_id) - document_ids_.begin();
+        if (position == document_ids_.size() || document_ids_[position] != document_id)
+            return false;
+        document_ids_.erase(document_ids_.begin() + position);
+        term_counts_.erase(term_counts_.begin() + position);
+        return true;
+    }
+
+    int document_ids[BLOCK_SIZE];
+    uint32_t term_counts[BLOCK_SIZE];
+    DecodeBlock(block_index, document_ids, term_counts);
+    // Последний идентификатор блока не меньше document_id, поэтому позиция лежит внутри блока
+    const size_t position = lower_bound(document_ids, document_ids + blocks_[block_index].entry_count, document_id) -
+                            document_ids;
+    if (document_ids[position] != document_id)
+        return false;
+    EraseFromBlock(block_index, document_ids, term_counts, position);
+    return true;
+}
+
+void PostingList::EraseMarked(const OrdinalBitmap& removed_documents, const vector<uint32_t>& document_lengths)
+{
+    DecodeAll();
+    size_t kept_count = 0;
+    max_term_freq_ = 0;
+    for (size_t i = 0; i < document_ids_.size(); ++i)
+        if (!removed_documents.Test(document_ids_[i]))
+        {
+            document_ids_[kept_count] = document_ids_[i];
+            term_counts_[kept_count] = term_counts_[i];
+            UpdateMaxTermFreq(term_counts_[i], document_lengths[document_ids_[i]]);
+            ++kept_count;
+        }
+    document_ids_.resize(kept_count);
+    term_counts_.resize(kept_count);
+    pending_removal_count_ = 0;
+    if (is_compressed_)
+        EncodeTail();
+}
+
+void PostingList::Assign(vector<int> document_ids, vector<uint32_t> term_counts, const vector<uint32_t>& document_lengths)
+{
+    blocks_.clear();
+    compressed_bytes_.clear();
+    block_entry_count_ = 0;
+    dead_byte_count_ = 0;
+    document_ids_ = move(document_ids);
+    term_counts_ = move(term_counts);
+    max_term_freq_ = 0;
+    for (size_t i = 0; i < document_ids_.size(); ++i)
+        UpdateMaxTermFreq(term_counts_[i], document_lengths[document_ids_[i]]);
+    pending_removal_count_ = 0;
+    if (is_compressed_)
+        EncodeTail();
+}
+
+void PostingList::RenumberDocuments(const vector<int>& new_document_ids, const vector<uint32_t>& document_lengths)
+{
+    if (empty())
+        return;
+    vector<int> document_ids;
+    vector<uint32_t> term_counts;
+    document_ids.reserve(size());
+    term_counts.reserve(size());
+    for (Cursor cursor(*this); cursor.GetDocumentId() != NO_DOCUMENT; cursor.Next())
+    {
+        document_ids.push_back(new_document_ids[cursor.GetDocumentId()]);
+        term_counts.push_back(cursor.GetTermCount());
+    }
+    Assign(move(document_ids), move(term_counts), document_lengths);
+}
+
+bool PostingList::Contains(int document_id) const
+{
+    return Cursor(*this, document_id).GetDocumentId() == document_id;
+}
+
+uint32_t PostingList::GetTermCount(int document_id) const
+{
+    const Cursor cursor(*this, document_id);
+    return cursor.GetDocumentId() == document_id ? cursor.GetTermCount() : 0;
+}
+
+void PostingList::SetCompressed(bool is_compressed)
+{
+    is_compressed_ = is_compressed;
+    if (is_compressed_)
+        EncodeTail();
+    else
+        DecodeAll();
+}
+
+size_t PostingList::GetByteSize() const
+{
+    return blocks_.size() * sizeof(BlockInfo) + compressed_bytes_.size() +
+           document_ids_.size() * (sizeof(int) + sizeof(uint32_t));
+}
+
+int PostingList::GetLastDocumentId() const
+{
+    return document_ids_.empty() ? blocks_.back().last_document_id : document_ids_.back();
+}
+
+void PostingList::DecodeBlock(size_t block_index, int* document_ids, uint32_t* term_counts) const
+{
+    const BlockInfo& block = blocks_[block_index];
+    const uint8_t *bytes = compressed_bytes_.data() + block.byte_offset;
+    int document_id = block.base_document_id;
+    for (size_t i = 0; i < block.entry_count; ++i)
+    {
+        document_id += ReadVarint(bytes);
+        document_ids[i] = document_id;
+    }
+    for (size_t i = 0; i < block.entry_count; ++i)
+        term_counts[i] = ReadVarint(bytes);
+}
+
+void PostingList::EncodeTail()
+{
+    size_t encoded_count = 0;
+    while (document_ids_.size() - encoded_count >= BLOCK_SIZE)
+    {
+        const int base_document_id = blocks_.empty() ? -1 : blocks_.back().last_document_id;
+        const size_t byte_offset = compressed_bytes_.size();
+        WriteBlock(compressed_bytes_, &document_ids_[encoded_count], &term_counts_[encoded_count], BLOCK_SIZE,
+                   base_document_id);
+        blocks_.push_back({base_document_id, document_ids_[encoded_count + BLOCK_SIZE - 1], BLOCK_SIZE, byte_offset,
+                           compressed_bytes_.size() - byte_offset});
+        encoded_count += BLOCK_SIZE;
+    }
+    block_entry_count_ += encoded_count;
+    document_ids_.erase(document_ids_.begin(), document_ids_.begin() + encoded_count);
+    term_counts_.erase(term_counts_.begin(), term_counts_.begin() + encoded_count);
+}
+
+void PostingList::EraseFromBlock(size_t block_index, int* document_ids, uint32_t* term_counts, size_t position)
+{
+    BlockInfo& block = blocks_[block_index];
+    const size_t entry_count = block.entry_count - 1;
+    copy(document_ids + position + 1, document_ids + block.entry_count, document_ids + position);
+    copy(term_counts + position + 1, term_counts + block.entry_count, term_counts + position);
+    --block_entry_count_;
+    if (entry_count == 0)
+    {
+        dead_byte_count_ += block.byte_size;
+        blocks_.erase(blocks_.begin() + block_index);
+    }
+    else
+    {
+        // Сумма двух разностей кодируется не длиннее их самих, поэтому блок без одного вхождения умещается
+        // на прежнем месте. Он кодируется в конец compressed_bytes_ и переносится на место блока.
+        const size_t encoded_offset = compressed_bytes_.size();
+        WriteBlock(compressed_bytes_, document_ids, term_counts, entry_count, block.base_document_id);
+        const size_t byte_size = compressed_bytes_.size() - encoded_offset;
+        copy(compressed_bytes_.begin() + encoded_offset, compressed_bytes_.end(),
+             compressed_bytes_.begin() + block.byte_offset);
+        compressed_bytes_.resize(encoded_offset);
+        dead_byte_count_ += block.byte_size - byte_size;
+        block.last_document_id = document_ids[entry_count - 1];
+        block.entry_count = entry_count;
+        block.byte_size = byte_size;
+
+        // Недозаполненный блок сливается с предыдущим или следующим; объединённый блок дописывается в конец
+        // compressed_bytes_, а место обоих прежних блоков освобождается
+        const auto can_merge = [this, entry_count](size_t neighbour_index)
+                               {
+                                   return neighbour_index < blocks_.size() &&
+                                          blocks_[neighbour_index].entry_count + entry_count <= BLOCK_SIZE;
+                               };
+        if (entry_count < BLOCK_SIZE / 2 && (can_merge(block_index - 1) || can_merge(block_index + 1)))
+        {
+            const size_t first_index = can_merge(block_index - 1) ? block_index - 1 : block_index;
+            BlockInfo& first = blocks_[first_index];
+            const BlockInfo& second = blocks_[first_index + 1];
+            int merged_document_ids[BLOCK_SIZE];
+            uint32_t merged_term_counts[BLOCK_SIZE];
+            DecodeBlock(first_index, merged_document_ids, merged_term_counts);
+            DecodeBlock(first_index + 1, merged_document_ids + first.entry_count, merged_term_counts + first.entry_count);
+            const size_t merged_count = first.entry_count + second.entry_count;
+            const size_t merged_offset = compressed_bytes_.size();
+            WriteBlock(compressed_bytes_, merged_document_ids, merged_term_counts, merged_count, first.base_document_id);
+            dead_byte_count_ += first.byte_size + second.byte_size;
+            first = {first.base_document_id, second.last_document_id, merged_count, merged_offset,
+                     compressed_bytes_.size() - merged_offset};
+            blocks_.erase(blocks_.begin() + first_index + 1);
+        }
+    }
+    if (dead_byte_count_ * 2 > compressed_bytes_.size())
+        CompactBytes();
+}
+
+void PostingList::CompactBytes()
+{
+    // После слияний блоки лежат в compressed_bytes_ не по порядку, поэтому они переписываются в новый массив
+    vector<uint8_t> compressed_bytes;
+    compressed_bytes.reserve(compressed_bytes_.size() - dead_byte_count_);
+    for (BlockInfo& block : blocks_)
+    {
+        const size_t byte_offset = compressed_bytes.size();
+        compressed_bytes.insert(compressed_bytes.end(), compressed_bytes_.begin() + block.byte_offset,
+                                compressed_bytes_.begin() + block.byte_offset + block.byte_size);
+        block.byte_offset = byte_offset;
+    }
+    compressed_bytes_ = move(compressed_bytes);
+    dead_byte_count_ = 0;
+}
+
+void PostingList::DecodeAll()
+{
+    if (blocks_.empty())
+        return;
+    vector<int> document_ids(block_entry_count_);
+    vector<uint32_t> term_counts(block_entry_count_);
+    size_t offset = 0;
+    for (size_t block_index = 0; block_index < blocks_.size(); ++block_index)
+    {
+        DecodeBlock(block_index, &document_ids[offset], &term_counts[offset]);
+        offset += blocks_[block_index].entry_count;
+    }
+    document_ids.insert(document_ids.end(), document_ids_.begin(), document_ids_.end());
+    term_counts.insert(term_counts.end(), term_counts_.begin(), term_counts_.end());
+    document_ids_ = move(document_ids);
+    term_counts_ = move(term_counts);
+    blocks_.clear();
+    compressed_bytes_.clear();
+    block_entry_count_ = 0;
+    dead_byte_count_ = 0;
+}
+
+void PostingList::UpdateMaxTermFreq(uint32_t term_count, uint32_t document_length)
+{
+    max_term_freq_ = max(max_term_freq_, term_count / static_cast<double>(document_length));
+}
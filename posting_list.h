@@ -0,0 +1,230 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <type_traits>
+#include <vector>
+#include "ordinal_bitmap.h"
+
+// Список вхождений слова (posting list): идентификаторы документов по возрастанию и количества вхождений
+// слова в эти документы. Частота слова в документе - количество вхождений, делённое на длину документа;
+// длины документов хранит владелец списка.
+//
+// Начало списка может храниться сжатым - блоками не более чем по BLOCK_SIZE вхождений, в которых разности
+// соседних идентификаторов и количества вхождений записаны кодом переменной длины (varint). Для каждого блока
+// отдельно хранятся последний идентификатор, количество вхождений и положение блока, что позволяет при поиске
+// перепрыгивать блоки, не декодируя их, а при удалении перекодировать только блок удаляемого документа. Конец списка ("хвост") хранится в двух несжатых массивах, так что добавление
+// документа в конец списка остаётся дешёвым. Несжатый список состоит из одного хвоста, в сжатом хвост
+// упаковывается в блок, как только набирает BLOCK_SIZE вхождений.
+class PostingList
+{
+public:
+    static constexpr int NO_DOCUMENT = std::numeric_limits<int>::max(); // Признак исчерпания курсора
+    static constexpr size_t BLOCK_SIZE = 128;
+
+    // Курсор для обхода вхождений с идентификаторами документов из [first_document_id, last_document_id)
+    class Cursor
+    {
+    public:
+        explicit Cursor(const PostingList& posting_list, int first_document_id = 0, int last_document_id = NO_DOCUMENT);
+        Cursor(const Cursor& other);
+        Cursor& operator=(const Cursor& other);
+
+        // Идентификатор текущего документа либо NO_DOCUMENT, если курсор исчерпан
+        int GetDocumentId() const
+        {
+            return document_id_;
+        }
+
+        uint32_t GetTermCount() const
+        {
+            return term_counts_ptr_[position_];
+        }
+
+        void Next()
+        {
+            ++position_;
+            if (position_ < chunk_size_)
+                SetDocumentId(document_ids_ptr_[position_]);
+            else
+                Settle();
+        }
+
+        // Продвигает курсор к первому документу с идентификатором не меньше document_id. Блоки пропускаются
+        // двоичным поиском по их последним идентификаторам, внутри блока поиск экспоненциальный, поэтому
+        // короткие продвижения курсора обходятся дёшево.
+        void SeekTo(int document_id);
+
+    private:
+        const PostingList *posting_list_ptr_;
+        int last_document_id_;
+        size_t block_index_; // Номер текущего блока; равен количеству блоков, когда курсор обходит хвост
+        const int *document_ids_ptr_; // Текущий фрагмент списка: декодированный блок либо хвост
+        const uint32_t *term_counts_ptr_;
+        size_t chunk_size_;
+        size_t position_;
+        int document_id_;
+        int decoded_document_ids_[BLOCK_SIZE];
+        uint32_t decoded_term_counts_[BLOCK_SIZE];
+
+        void SetDocumentId(int document_id)
+        {
+            document_id_ = document_id < last_document_id_ ? document_id : NO_DOCUMENT;
+        }
+
+        // Переходит к следующим фрагментам, пока текущий исчерпан, и обновляет document_id_
+        void Settle();
+        void EnterChunk(size_t block_index);
+    };
+
+    explicit PostingList(bool is_compressed = false);
+
+    // Добавляет документ document_id длины document_length, в котором слово встречается term_count раз.
+    // Если документ уже есть в списке, количество вхождений увеличивается.
+    void Add(int document_id, uint32_t term_count, uint32_t document_length);
+    // Удаляет документ из списка, возвращает false, если документа в списке не было
+    bool Erase(int document_id);
+    // Учитывает, что один из документов списка удалён логически и ждёт уплотнения списка
+    void MarkPendingRemoval()
+    {
+        ++pending_removal_count_;
+    }
+    // Уплотнение: удаляет из списка документы, отмеченные в removed_documents, за один проход.
+    // document_lengths - длины документов по их идентификаторам, по ним пересчитывается верхняя граница частоты.
+    void EraseMarked(const OrdinalBitmap& removed_documents, const std::vector<uint32_t>& document_lengths);
+    // Заменяет содержимое списка готовыми массивами; document_ids должны быть упорядочены по возрастанию
+    void Assign(std::vector<int> document_ids, std::vector<uint32_t> term_counts,
+                const std::vector<uint32_t>& document_lengths);
+    // Заменяет идентификатор каждого документа списка на new_document_ids[идентификатор]. Новые идентификаторы
+    // должны возрастать вместе с прежними; document_lengths - длины документов по новым идентификаторам.
+    void RenumberDocuments(const std::vector<int>& new_document_ids, const std::vector<uint32_t>& document_lengths);
+    bool Contains(int document_id) const;
+    // Количество вхождений слова в документ document_id либо 0, если документа в списке нет
+    uint32_t GetTermCount(int document_id) const;
+    // Включает или выключает хранение начала списка в сжатом виде
+    void SetCompressed(bool is_compressed);
+
+    bool IsCompressed() const
+    {
+        return is_compressed_;
+    }
+
+    // Верхняя граница частоты слова по всем документам списка. После удалений граница может оказаться
+    // завышенной, но никогда не бывает меньше действительного максимума.
+    double GetMaxTermFreq() const
+    {
+        return max_term_freq_;
+    }
+
+    size_t size() const
+    {
+        return block_entry_count_ + document_ids_.size();
+    }
+
+    // Количество документов списка без учёта логически удалённых
+    size_t GetDocumentCount() const
+    {
+        return size() - pending_removal_count_;
+    }
+
+    bool empty() const
+    {
+        return size() == 0;
+    }
+
+    // Объём памяти, занимаемый вхождениями списка, в байтах
+    size_t GetByteSize() const;
+
+    // Обратная частота слова, сохранённая для эпохи индекса index_epoch, либо пустое значение. Обратную
+    // частоту вычисляет владелец списка; сохранённое значение читается и обновляется параллельными запросами.
+    std::optional<double> FindInverseDocumentFreq(uint64_t index_epoch) const
+    {
+        if (inverse_document_freq_.index_epoch.load(std::memory_order_acquire) != index_epoch)
+            return std::nullopt;
+        return inverse_document_freq_.value.load(std::memory_order_relaxed);
+    }
+
+    // Одновременно сохранять значение могут лишь запросы одной и той же эпохи, то есть одно и то же значение
+    void StoreInverseDocumentFreq(uint64_t index_epoch, double inverse_document_freq) const
+    {
+        inverse_document_freq_.value.store(inverse_document_freq, std::memory_order_relaxed);
+        inverse_document_freq_.index_epoch.store(index_epoch, std::memory_order_release);
+    }
+
+private:
+    // Блоки декодируются независимо друг от друга: первая разность блока отсчитывается от base_document_id,
+    // а не от последнего идентификатора предыдущего блока, который меняется при удалении из того блока
+    struct BlockInfo
+    {
+        int base_document_id;
+        int last_document_id;
+        size_t entry_count; // От 1 до BLOCK_SIZE
+        size_t byte_offset; // Смещение блока в compressed_bytes_
+        size_t byte_size;
+    };
+
+    // Сохранённая обратная частота. Копирование переносит значения, чтобы списки можно было хранить в векторе.
+    struct InverseDocumentFreqCache
+    {
+        static constexpr uint64_t NO_EPOCH = std::numeric_limits<uint64_t>::max();
+
+        std::atomic<uint64_t> index_epoch{NO_EPOCH};
+        std::atomic<double> value{0};
+
+        InverseDocumentFreqCache() = default;
+
+        // Копирование и перемещение не бросают исключений, чтобы массив списков вхождений
+        // при перераспределении перемещал списки, а не копировал их
+        InverseDocumentFreqCache(const InverseDocumentFreqCache& other) noexcept
+        {
+            *this = other;
+        }
+
+        InverseDocumentFreqCache(InverseDocumentFreqCache&& other) noexcept
+        {
+            *this = other;
+        }
+
+        InverseDocumentFreqCache& operator=(const InverseDocumentFreqCache& other) noexcept
+        {
+            value.store(other.value.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            index_epoch.store(other.index_epoch.load(std::memory_order_acquire), std::memory_order_release);
+            return *this;
+        }
+
+        InverseDocumentFreqCache& operator=(InverseDocumentFreqCache&& other) noexcept
+        {
+            return *this = other;
+        }
+    };
+
+    bool is_compressed_;
+    std::vector<BlockInfo> blocks_;
+    std::vector<uint8_t> compressed_bytes_;
+    size_t block_entry_count_ = 0; // Количество вхождений во всех блоках
+    size_t dead_byte_count_ = 0; // Байты compressed_bytes_, не принадлежащие ни одному блоку после удалений
+    std::vector<int> document_ids_; // Хвост: идентификаторы документов по возрастанию
+    std::vector<uint32_t> term_counts_; // Хвост: количества вхождений слова в документы, в том же порядке
+    double max_term_freq_ = 0;
+    size_t pending_removal_count_ = 0;
+    mutable InverseDocumentFreqCache inverse_document_freq_;
+
+    int GetLastDocumentId() const;
+    // Декодирует блок в массивы длины не меньше количества вхождений блока
+    void DecodeBlock(size_t block_index, int* document_ids, uint32_t* term_counts) const;
+    // Упаковывает в блоки все полные группы по BLOCK_SIZE вхождений из начала хвоста
+    void EncodeTail();
+    // Удаляет вхождение position из блока block_index, декодированного в document_ids и term_counts.
+    // Перекодируется только этот блок; блок, в котором осталось меньше половины BLOCK_SIZE вхождений,
+    // сливается с соседним, если они умещаются в один блок.
+    void EraseFromBlock(size_t block_index, int* document_ids, uint32_t* term_counts, size_t position);
+    // Сдвигает блоки к началу compressed_bytes_, освобождая байты, оставшиеся от удалений
+    void CompactBytes();
+    // Распаковывает все блоки обратно в начало хвоста
+    void DecodeAll();
+    void UpdateMaxTermFreq(uint32_t term_count, uint32_t document_length);
+};
+
+static_assert(std::is_nothrow_move_constructible_v<PostingList>);
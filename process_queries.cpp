@@ -1,9 +1,11 @@
 #include <string>
 #include <vector>
-#include <list>
 #include <algorithm>
-#include <numeric>
+#include <exception>
 #include <execution>
+#include <iterator>
+#include <type_traits>
+#include <utility>
 
 #include "process_queries.h"
 
@@ -11,22 +13,61 @@ using namespace std;
 
 vector<vector<Document>> ProcessQueries(const SearchServer& search_server, const vector<string>& queries)
 {
-    vector<vector<Document>> resull(queries.size());
-    transform(execution::par, queries.begin(), queries.end(), resull.begin(),
-              [&search_server](string query)
-              {
-                return search_server.FindTopDocuments(query);
-              });
-    return resull;
+    return search_server.FindTopDocumentsBatch(execution::par, queries);
 }
 
-list<Document> ProcessQueriesJoined(const SearchServer& search_server, const vector<string>& queries)
+JoinedDocuments ProcessQueriesJoined(const SearchServer& search_server, const vector<string>& queries)
 {
-    auto intermediate_container = ProcessQueries(search_server, queries);
-    return accumulate(intermediate_container.begin(), intermediate_container.end(), list<Document>(),
-                      [](list<Document>& accumulator_list, const vector<Document>& current_vector) -> list<Document>&
-                      {
-                            accumulator_list.splice(accumulator_list.end(), list<Document>(current_vector.begin(), current_vector.end()));
-                            return accumulator_list;
-                      });
+    // Результаты приходят в порядке готовности и дописываются в один общий массив; для каждого запроса
+    // запоминается его отрезок, после чего документы одним проходом переставляются в порядок запросов
+    vector<Document> arrived_documents;
+    vector<pair<size_t, size_t>> arrived_ranges(queries.size()); // Начало и длина отрезка каждого запроса
+    ProcessQueriesStreamed(search_server, queries,
+                           [&arrived_documents, &arrived_ranges](size_t query_index, auto&& documents)
+                           {
+                               arrived_ranges[query_index] = {arrived_documents.size(), documents.size()};
+                               if constexpr (is_rvalue_reference_v<decltype(documents)>)
+                                   arrived_documents.insert(arrived_documents.end(), make_move_iterator(documents.begin()),
+                                                            make_move_iterator(documents.end()));
+                               else
+                                   arrived_documents.insert(arrived_documents.end(), documents.begin(), documents.end());
+                           });
+
+    JoinedDocuments joined_documents;
+    joined_documents.query_offsets.reserve(queries.size() + 1);
+    joined_documents.query_offsets.push_back(0);
+    joined_documents.documents.reserve(arrived_documents.size());
+    for (const auto& [first, count] : arrived_ranges)
+    {
+        const auto range_begin = arrived_documents.begin() + first;
+        joined_documents.documents.insert(joined_documents.documents.end(), make_move_iterator(range_begin),
+                                          make_move_iterator(range_begin + count));
+        joined_documents.query_offsets.push_back(joined_documents.documents.size());
+    }
+    return joined_documents;
+}
+
+vector<vector<Document>> ProcessQueries(RequestQueue& request_queue, const vector<string>& queries)
+{
+    // Исключение не должно покидать параллельный алгоритм (иначе вызывается std::terminate), поэтому
+    // ошибки запоминаются по запросам, и после прохода выбрасывается ошибка первого из ошибочных запросов
+    vector<vector<Document>> query_documents(queries.size());
+    vector<exception_ptr> query_errors(queries.size());
+    for_each(execution::par, queries.begin(), queries.end(),
+             [&request_queue, &queries, &query_documents, &query_errors](const string& query)
+             {
+                 const size_t i = &query - queries.data();
+                 try
+                 {
+                     query_documents[i] = request_queue.AddFindRequest(query);
+                 }
+                 catch (...)
+                 {
+                     query_errors[i] = current_exception();
+                 }
+             });
+    for (const exception_ptr& query_error : query_errors)
+        if (query_error)
+            rethrow_exception(query_error);
+    return query_documents;
 }
@@ -1,11 +1,53 @@
 #pragma once
 
+#include <cstddef>
 #include <string>
+#include <utility>
 #include <vector>
-#include <list>
+#include <execution>
 
 #include "document.h"
+#include "request_queue.h"
 #include "search_server.h"
 
+// Результаты пакета запросов, уложенные подряд в один массив: документы запроса i занимают
+// отрезок [query_offsets[i], query_offsets[i + 1]) массива documents
+struct JoinedDocuments
+{
+    using const_iterator = std::vector<Document>::const_iterator;
+
+    std::vector<Document> documents;
+    std::vector<size_t> query_offsets;
+
+    const_iterator begin() const
+    {
+        return documents.begin();
+    }
+
+    const_iterator end() const
+    {
+        return documents.end();
+    }
+
+    size_t GetQueryCount() const
+    {
+        return query_offsets.size() - 1;
+    }
+
+    std::pair<const_iterator, const_iterator> GetQueryDocuments(size_t query_index) const
+    {
+        return {documents.begin() + query_offsets[query_index], documents.begin() + query_offsets[query_index + 1]};
+    }
+};
+
 std::vector<std::vector<Document>> ProcessQueries(const SearchServer& search_server, const std::vector<std::string> &queries);
-std::list<Document> ProcessQueriesJoined(const SearchServer& search_server, const std::vector<std::string>& queries);
+JoinedDocuments ProcessQueriesJoined(const SearchServer& search_server, const std::vector<std::string>& queries);
+// Параллельно выполняет запросы через request_queue, записывая каждый в её журнал
+std::vector<std::vector<Document>> ProcessQueries(RequestQueue& request_queue, const std::vector<std::string>& queries);
+
+// Передаёт результат каждого запроса в sink(query_index, documents) по мере готовности (см. SearchServer::StreamTopDocumentsBatch)
+template <class ResultSink>
+void ProcessQueriesStreamed(const SearchServer& search_server, const std::vector<std::string>& queries, ResultSink&& sink)
+{
+    search_server.StreamTopDocumentsBatch(std::execution::par, queries, sink);
+}
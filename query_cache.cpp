@@ -0,0 +1,91 @@
+#include <functional>
+#include "query_cache.h"
+
+using namespace std;
+
+bool QueryCacheKey::operator==(const QueryCacheKey& other) const
+{
+    return status == other.status && result_document_count == other.result_document_count &&
+           plus_terms == other.plus_terms && minus_terms == other.minus_terms;
+}
+
+size_t QueryCacheKeyHasher::operator()(const QueryCacheKey& key) const
+{
+    size_t hash = static_cast<size_t>(key.status) * 31 + static_cast<size_t>(key.result_document_count);
+    auto combine = [&hash](TermId term_id)
+    {
+        hash ^= std::hash<TermId>{}(term_id) + 0x9E3779B9 + (hash << 6) + (hash >> 2);
+    };
+    for (const TermId term_id : key.plus_terms)
+        combine(term_id);
+    // Разделитель, чтобы слово, перенесённое из плюс-слов в минус-слова, меняло хеш
+    combine(TermDictionary::NO_TERM);
+    for (const TermId term_id : key.minus_terms)
+        combine(term_id);
+    return hash;
+}
+
+QueryResultCache::QueryResultCache(size_t capacity) : capacity_(capacity)
+{}
+
+optional<vector<Document>> QueryResultCache::Find(const QueryCacheKey& key, uint64_t index_epoch)
+{
+    lock_guard lock(cache_mutex_);
+    const auto index_it = entry_index_.find(key);
+    if (index_it == entry_index_.end())
+    {
+        ++miss_count_;
+        return nullopt;
+    }
+    const EntryList::iterator entry_it = index_it->second;
+    if (entry_it->index_epoch != index_epoch)
+    {
+        // Индекс изменился после вычисления результата
+        entry_index_.erase(index_it);
+        entries_.erase(entry_it);
+        ++miss_count_;
+        return nullopt;
+    }
+    entries_.splice(entries_.begin(), entries_, entry_it);
+    ++hit_count_;
+    return entry_it->documents;
+}
+
+void QueryResultCache::Insert(QueryCacheKey key, uint64_t index_epoch, vector<Document> documents)
+{
+    lock_guard lock(cache_mutex_);
+    const auto index_it = entry_index_.find(key);
+    if (index_it != entry_index_.end())
+    {
+        // Тот же запрос мог быть вычислен одновременно несколькими потоками
+        index_it->second->index_epoch = index_epoch;
+        index_it->second->documents = move(documents);
+        entries_.splice(entries_.begin(), entries_, index_it->second);
+        return;
+    }
+    entries_.push_front({move(key), index_epoch, move(documents)});
+    entry_index_.emplace(entries_.front().key, entries_.begin());
+    EvictExcess();
+}
+
+void QueryResultCache::SetCapacity(size_t capacity)
+{
+    lock_guard lock(cache_mutex_);
+    capacity_ = capacity;
+    EvictExcess();
+}
+
+QueryCacheStats QueryResultCache::GetStats() const
+{
+    lock_guard lock(cache_mutex_);
+    return {hit_count_, miss_count_, entries_.size(), capacity_};
+}
+
+void QueryResultCache::EvictExcess()
+{
+    while (entries_.size() > capacity_)
+    {
+        entry_index_.erase(entries_.back().key);
+        entries_.pop_back();
+    }
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+#include "document.h"
+#include "term_dictionary.h"
+
+// Ключ кэша результатов: разобранный запрос (упорядоченные идентификаторы плюс- и минус-слов),
+// требуемый статус документов и количество выдаваемых документов
+struct QueryCacheKey
+{
+    std::vector<TermId> plus_terms;
+    std::vector<TermId> minus_terms;
+    DocumentStatus status;
+    int result_document_count;
+
+    bool operator==(const QueryCacheKey& other) const;
+};
+
+struct QueryCacheKeyHasher
+{
+    size_t operator()(const QueryCacheKey& key) const;
+};
+
+// Счётчики кэша результатов
+struct QueryCacheStats
+{
+    uint64_t hit_count = 0;
+    uint64_t miss_count = 0;
+    size_t size = 0;
+    size_t capacity = 0;
+};
+
+// Кэш результатов поиска ограниченного размера с вытеснением давно не использованных записей (LRU).
+// Каждая запись помечена эпохой индекса, в которой она была вычислена; записи прежних эпох считаются
+// отсутствующими и удаляются при обращении или вытесняются. Все операции защищены мьютексом, так что
+// кэшем могут пользоваться несколько потоков, выполняющих запросы одновременно.
+class QueryResultCache
+{
+public:
+    explicit QueryResultCache(size_t capacity);
+
+    // Результат запроса, вычисленный в эпоху index_epoch, либо пустое значение
+    std::optional<std::vector<Document>> Find(const QueryCacheKey& key, uint64_t index_epoch);
+    void Insert(QueryCacheKey key, uint64_t index_epoch, std::vector<Document> documents);
+    // Изменяет наибольшее количество записей, при необходимости вытесняя лишние
+    void SetCapacity(size_t capacity);
+    QueryCacheStats GetStats() const;
+
+private:
+    struct Entry
+    {
+        QueryCacheKey key;
+        uint64_t index_epoch;
+        std::vector<Document> documents;
+    };
+
+    using EntryList = std::list<Entry>;
+
+    mutable std::mutex cache_mutex_;
+    size_t capacity_;
+    EntryList entries_; // Записи в порядке от недавно использованных к давно не использованным
+    std::unordered_map<QueryCacheKey, EntryList::iterator, QueryCacheKeyHasher> entry_index_;
+    uint64_t hit_count_ = 0;
+    uint64_t miss_count_ = 0;
+
+    void EvictExcess();
+};
@@ -0,0 +1,270 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include "request_log.h"
+
+using namespace std;
+
+namespace
+{
+    // Номер корзины гистограммы, в которую попадает доля fraction всех значений
+    template <size_t BUCKET_COUNT>
+    size_t FindPercentileBucket(const array<uint64_t, BUCKET_COUNT>& bucket_counts, uint64_t total_count, double fraction)
+    {
+        const uint64_t rank = max<uint64_t>(1, static_cast<uint64_t>(ceil(fraction * total_count)));
+        uint64_t cumulative_count = 0;
+        for (size_t bucket = 0; bucket < BUCKET_COUNT; ++bucket)
+        {
+            cumulative_count += bucket_counts[bucket];
+            if (cumulative_count >= rank)
+                return bucket;
+        }
+        return BUCKET_COUNT - 1;
+    }
+
+    size_t GetResultBucketBound(size_t bucket)
+    {
+        return (size_t(1) << bucket) - 1;
+    }
+}
+
+void RequestLog::IntervalCounter::Increment(uint64_t period, atomic<int64_t>& total)
+{
+    const uint32_t period_low = static_cast<uint32_t>(period);
+    uint64_t value = value_.load(memory_order_relaxed);
+    while (true)
+    {
+        const uint32_t stored_period = static_cast<uint32_t>(value >> 32);
+        const bool is_expired = value & EXPIRED_BIT;
+        const uint64_t count = value & COUNT_MASK;
+        // Нулевое значение - у счётчика, в котором ещё не начинался ни один интервал: начатый счётчик
+        // хранит ненулевое количество, истёкший - признак истечения
+        const int32_t period_lead = value == 0 ? 1 : static_cast<int32_t>(period_low - stored_period);
+        // Запрос более раннего интервала, чем начатый, и запрос истёкшего интервала не учитываются
+        if (period_lead < 0 || (is_expired && period_lead == 0))
+            return;
+        uint64_t next_value;
+        int64_t total_delta;
+        if (period_lead == 0)
+        {
+            if (count == COUNT_MASK)
+                return;
+            next_value = value + 1;
+            total_delta = 1;
+        }
+        else
+        {
+            // Начинается счёт нового интервала; неистёкшее количество прежнего вычитается из итога здесь
+            next_value = (uint64_t(period_low) << 32) | 1;
+            total_delta = 1 - static_cast<int64_t>(is_expired ? 0 : count);
+        }
+        if (value_.compare_exchange_weak(value, next_value, memory_order_relaxed))
+        {
+            total.fetch_add(total_delta, memory_order_relaxed);
+            return;
+        }
+    }
+}
+
+void RequestLog::IntervalCounter::Expire(uint64_t last_expired_period, atomic<int64_t>& total)
+{
+    const uint32_t last_expired_low = static_cast<uint32_t>(last_expired_period);
+    uint64_t value = value_.load(memory_order_relaxed);
+    while (true)
+    {
+        const uint32_t stored_period = static_cast<uint32_t>(value >> 32);
+        const bool is_expired = value & EXPIRED_BIT;
+        const int32_t period_lag = static_cast<int32_t>(last_expired_low - stored_period);
+        if (value == 0 || period_lag < 0 || (is_expired && period_lag == 0))
+            return;
+        const uint64_t next_value = (uint64_t(last_expired_low) << 32) | EXPIRED_BIT;
+        if (value_.compare_exchange_weak(value, next_value, memory_order_relaxed))
+        {
+            if (!is_expired)
+                total.fetch_sub(static_cast<int64_t>(value & COUNT_MASK), memory_order_relaxed);
+            return;
+        }
+    }
+}
+
+RequestLog::RequestLog(chrono::seconds window, size_t interval_count, size_t recent_capacity)
+{
+    if (interval_count == 0 || window.count() <= 0 ||
+        chrono::duration_cast<chrono::nanoseconds>(window).count() < static_cast<int64_t>(interval_count))
+        throw invalid_argument("Журнал запросов : неверная длительность окна или количество интервалов"s);
+    if (recent_capacity == 0)
+        throw invalid_argument("Журнал запросов : нулевая ёмкость журнала последних запросов"s);
+    interval_nanoseconds_ = chrono::duration_cast<chrono::nanoseconds>(window).count() / interval_count;
+    intervals_ = vector<Interval>(interval_count);
+
+    size_t slot_count = 1;
+    while (slot_count < recent_capacity)
+        slot_count *= 2;
+    slots_ = vector<Slot>(slot_count);
+}
+
+void RequestLog::Record(const RequestRecord& record)
+{
+    total_count_.fetch_add(1, memory_order_relaxed);
+
+    const uint64_t period = GetPeriod(record.time);
+    AdvanceWindow(period);
+    Interval& interval = intervals_[period % intervals_.size()];
+    interval.request_count.Increment(period, totals_.request_count);
+    if (record.result_count == 0)
+        interval.no_result_count.Increment(period, totals_.no_result_count);
+    size_t latency_bucket = 0;
+    while (latency_bucket + 1 < LATENCY_BUCKET_COUNT &&
+           static_cast<uint64_t>(record.latency.count()) > LatencyHistogramSnapshot::GetBucketBound(latency_bucket))
+        ++latency_bucket;
+    interval.latency_counts[latency_bucket].Increment(period, totals_.latency_counts[latency_bucket]);
+    const size_t result_bucket = GetResultBucket(record.result_count);
+    interval.result_counts[result_bucket].Increment(period, totals_.result_counts[result_bucket]);
+
+    StoreRecent(record);
+}
+
+RequestWindowStats RequestLog::GetWindowStats(Clock::time_point now) const
+{
+    AdvanceWindow(GetPeriod(now));
+    const auto load_total = [](const atomic<int64_t>& total)
+                            {
+                                return static_cast<uint64_t>(max<int64_t>(0, total.load(memory_order_relaxed)));
+                            };
+
+    RequestWindowStats stats;
+    stats.request_count = load_total(totals_.request_count);
+    stats.no_result_count = load_total(totals_.no_result_count);
+    array<uint64_t, LATENCY_BUCKET_COUNT> latency_counts;
+    array<uint64_t, RESULT_BUCKET_COUNT> result_counts;
+    uint64_t latency_histogram_count = 0;
+    uint64_t result_histogram_count = 0;
+    for (size_t bucket = 0; bucket < LATENCY_BUCKET_COUNT; ++bucket)
+    {
+        latency_counts[bucket] = load_total(totals_.latency_counts[bucket]);
+        latency_histogram_count += latency_counts[bucket];
+    }
+    for (size_t bucket = 0; bucket < RESULT_BUCKET_COUNT; ++bucket)
+    {
+        result_counts[bucket] = load_total(totals_.result_counts[bucket]);
+        result_histogram_count += result_counts[bucket];
+    }
+    if (latency_histogram_count == 0 || result_histogram_count == 0)
+        return stats;
+
+    // Итоги пополняются независимо, поэтому при одновременной записи гистограммы могут разойтись
+    // с количеством запросов на несколько единиц; процентили считаются по самим гистограммам
+    const auto latency_bound = [&latency_counts, latency_histogram_count](double fraction)
+                               {
+                                   return chrono::nanoseconds(LatencyHistogramSnapshot::GetBucketBound(
+                                       FindPercentileBucket(latency_counts, latency_histogram_count, fraction)));
+                               };
+    const auto result_count_bound = [&result_counts, result_histogram_count](double fraction)
+                                    {
+                                        return GetResultBucketBound(
+                                            FindPercentileBucket(result_counts, result_histogram_count, fraction));
+                                    };
+    stats.latency_p50 = latency_bound(0.5);
+    stats.latency_p90 = latency_bound(0.9);
+    stats.latency_p99 = latency_bound(0.99);
+    stats.result_count_p50 = result_count_bound(0.5);
+    stats.result_count_p90 = result_count_bound(0.9);
+    stats.result_count_p99 = result_count_bound(0.99);
+    return stats;
+}
+
+uint64_t RequestLog::GetNoResultCount(Clock::time_point now) const
+{
+    AdvanceWindow(GetPeriod(now));
+    return static_cast<uint64_t>(max<int64_t>(0, totals_.no_result_count.load(memory_order_relaxed)));
+}
+
+vector<RequestRecord> RequestLog::GetRecentRequests() const
+{
+    const uint64_t end_ticket = next_ticket_.load(memory_order_acquire);
+    const uint64_t first_ticket = end_ticket > slots_.size() ? end_ticket - slots_.size() : 0;
+    vector<RequestRecord> records;
+    records.reserve(end_ticket - first_ticket);
+    for (uint64_t ticket = first_ticket; ticket < end_ticket; ++ticket)
+    {
+        const Slot& slot = slots_[ticket & (slots_.size() - 1)];
+        const uint64_t sequence = slot.sequence.load(memory_order_acquire);
+        if (sequence != 2 * ticket + 2)
+            continue;
+        RequestRecord record;
+        record.time = Clock::time_point(chrono::duration_cast<Clock::duration>(
+            chrono::nanoseconds(slot.time_nanoseconds.load(memory_order_relaxed))));
+        record.type = static_cast<RequestType>(slot.type.load(memory_order_relaxed));
+        record.latency = chrono::nanoseconds(slot.latency_nanoseconds.load(memory_order_relaxed));
+        record.result_count = slot.result_count.load(memory_order_relaxed);
+        atomic_thread_fence(memory_order_acquire);
+        if (slot.sequence.load(memory_order_relaxed) == sequence)
+            records.push_back(record);
+    }
+    return records;
+}
+
+uint64_t RequestLog::GetPeriod(Clock::time_point time) const
+{
+    const int64_t time_nanoseconds = chrono::duration_cast<chrono::nanoseconds>(time.time_since_epoch()).count();
+    return static_cast<uint64_t>(max<int64_t>(0, time_nanoseconds / interval_nanoseconds_));
+}
+
+void RequestLog::AdvanceWindow(uint64_t period) const
+{
+    uint64_t end_period = window_end_period_.load(memory_order_relaxed);
+    do
+    {
+        if (end_period != NO_PERIOD && period <= end_period)
+            return;
+    }
+    while (!window_end_period_.compare_exchange_weak(end_period, period, memory_order_relaxed));
+    if (end_period == NO_PERIOD)
+        return;
+
+    // Из окна выходят интервалы, ячейки которых занимают интервалы (end_period, period]; при сдвиге
+    // больше чем на всё окно истекают все ячейки
+    const uint64_t last_expired_period = period - intervals_.size();
+    const size_t step_count = static_cast<size_t>(min<uint64_t>(period - end_period, intervals_.size()));
+    for (size_t step = 1; step <= step_count; ++step)
+        ExpireInterval(intervals_[(end_period + step) % intervals_.size()], last_expired_period);
+}
+
+void RequestLog::ExpireInterval(Interval& interval, uint64_t last_expired_period) const
+{
+    interval.request_count.Expire(last_expired_period, totals_.request_count);
+    interval.no_result_count.Expire(last_expired_period, totals_.no_result_count);
+    for (size_t bucket = 0; bucket < LATENCY_BUCKET_COUNT; ++bucket)
+        interval.latency_counts[bucket].Expire(last_expired_period, totals_.latency_counts[bucket]);
+    for (size_t bucket = 0; bucket < RESULT_BUCKET_COUNT; ++bucket)
+        interval.result_counts[bucket].Expire(last_expired_period, totals_.result_counts[bucket]);
+}
+
+size_t RequestLog::GetResultBucket(size_t result_count)
+{
+    size_t bucket = 0;
+    while (bucket + 1 < RESULT_BUCKET_COUNT && result_count > GetResultBucketBound(bucket))
+        ++bucket;
+    return bucket;
+}
+
+void RequestLog::StoreRecent(const RequestRecord& record)
+{
+    const uint64_t ticket = next_ticket_.fetch_add(1, memory_order_relaxed);
+    Slot& slot = slots_[ticket & (slots_.size() - 1)];
+    // Ячейку, которую ещё заполняет другой писатель или уже занял более поздний запрос, писатель уступает:
+    // запрос теряется только для журнала последних запросов, показатели окна его уже учли
+    uint64_t sequence = slot.sequence.load(memory_order_relaxed);
+    if ((sequence & 1) || sequence > 2 * ticket ||
+        !slot.sequence.compare_exchange_strong(sequence, 2 * ticket + 1, memory_order_relaxed))
+        return;
+    atomic_thread_fence(memory_order_release);
+    slot.time_nanoseconds.store(chrono::duration_cast<chrono::nanoseconds>(record.time.time_since_epoch()).count(),
+                                memory_order_relaxed);
+    slot.type.store(static_cast<uint8_t>(record.type), memory_order_relaxed);
+    slot.latency_nanoseconds.store(record.latency.count(), memory_order_relaxed);
+    slot.result_count.store(record.result_count, memory_order_relaxed);
+    slot.sequence.store(2 * ticket + 2, memory_order_release);
+}
@@ -0,0 +1,149 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+#include "search_metrics.h"
+
+enum class RequestType
+{
+    UNKNOWN_REQUEST = 0,
+    PREDICATE_REQUEST,
+    STATUS_REQUEST
+};
+
+// Запрос, учтённый журналом запросов
+struct RequestRecord
+{
+    std::chrono::system_clock::time_point time;
+    RequestType type = RequestType::UNKNOWN_REQUEST;
+    std::chrono::nanoseconds latency{0};
+    size_t result_count = 0;
+};
+
+// Показатели запросов за окно журнала (см. RequestLog::GetWindowStats). Процентили оцениваются
+// по гистограммам с корзинами, границы которых растут степенями двойки, и равны верхней границе корзины.
+struct RequestWindowStats
+{
+    uint64_t request_count = 0;
+    uint64_t no_result_count = 0;
+    std::chrono::nanoseconds latency_p50{0};
+    std::chrono::nanoseconds latency_p90{0};
+    std::chrono::nanoseconds latency_p99{0};
+    size_t result_count_p50 = 0;
+    size_t result_count_p90 = 0;
+    size_t result_count_p99 = 0;
+};
+
+// Журнал запросов, в который могут одновременно писать несколько потоков без блокировок.
+// Показатели собираются по скользящему окну времени: окно делится на интервалы, и для окна целиком
+// поддерживаются итоговые счётчики (количества запросов и корзины гистограмм). Запись запроса пополняет
+// счётчик своего интервала и итог окна, а истёкший интервал вычитается из итога, когда окно сдвигается,
+// поэтому и запись, и чтение показателей стоят O(1) (сдвиг окна на k интервалов стоит O(min(k, количество
+// интервалов)) и выполняется один раз на интервал). Последние запросы сохраняются в кольцевом буфере.
+class RequestLog
+{
+public:
+    using Clock = std::chrono::system_clock;
+
+    static constexpr std::chrono::seconds DEFAULT_WINDOW = std::chrono::hours(24);
+    static constexpr size_t DEFAULT_INTERVAL_COUNT = 1440; // Сутки по минуте
+    static constexpr size_t DEFAULT_RECENT_CAPACITY = 1024;
+
+    // recent_capacity округляется вверх до степени двойки
+    explicit RequestLog(std::chrono::seconds window = DEFAULT_WINDOW, size_t interval_count = DEFAULT_INTERVAL_COUNT,
+                        size_t recent_capacity = DEFAULT_RECENT_CAPACITY);
+
+    void Record(const RequestRecord& record);
+    // Показатели запросов, записанных за окно, оканчивающееся в now. Окно не сдвигается назад: если now
+    // раньше времени уже учтённого запроса или чтения, показатели относятся к окну, оканчивающемуся в нём.
+    RequestWindowStats GetWindowStats(Clock::time_point now = Clock::now()) const;
+    // Количество запросов без результатов за окно, оканчивающееся в now (см. GetWindowStats)
+    uint64_t GetNoResultCount(Clock::time_point now = Clock::now()) const;
+    // Последние запросы, от давних к недавним. Запросы, запись которых ещё не завершена или уже
+    // затёрта более новыми, пропускаются.
+    std::vector<RequestRecord> GetRecentRequests() const;
+
+    // Количество всех записанных запросов
+    uint64_t GetTotalCount() const
+    {
+        return total_count_.load(std::memory_order_relaxed);
+    }
+
+private:
+    static constexpr size_t LATENCY_BUCKET_COUNT = LatencyHistogramSnapshot::BUCKET_COUNT;
+    static constexpr size_t RESULT_BUCKET_COUNT = 32; // Корзина k - от 2^(k-1) до 2^k - 1 результатов, корзина 0 - ни одного
+
+    static constexpr uint64_t NO_PERIOD = std::numeric_limits<uint64_t>::max();
+
+    // Счётчик интервала: в старших 32 битах - младшие разряды номера интервала времени, затем признак истечения,
+    // в младших 31 бите - количество. Истёкший счётчик хранит номер последнего истёкшего интервала своей
+    // ячейки, и запросы этого и более ранних интервалов в него уже не попадают. Количество вычитается
+    // из итога окна тем, кто помечает счётчик истёкшим либо начинает в нём счёт нового интервала, - ровно
+    // одним из них, так как оба изменения делаются одной атомарной заменой значения. Номера интервалов
+    // сравниваются по модулю 2^32, что верно, пока они отстоят друг от друга меньше чем на 2^31 интервалов.
+    class IntervalCounter
+    {
+    public:
+        // Учитывает запрос интервала period в счётчике и в итоге окна total
+        void Increment(uint64_t period, std::atomic<int64_t>& total);
+        // Помечает счётчик истёкшим, если он относится к интервалу не позже last_expired_period
+        void Expire(uint64_t last_expired_period, std::atomic<int64_t>& total);
+
+    private:
+        static constexpr uint64_t EXPIRED_BIT = uint64_t(1) << 31;
+        static constexpr uint64_t COUNT_MASK = EXPIRED_BIT - 1;
+
+        std::atomic<uint64_t> value_{0};
+    };
+
+    struct Interval
+    {
+        IntervalCounter request_count;
+        IntervalCounter no_result_count;
+        std::array<IntervalCounter, LATENCY_BUCKET_COUNT> latency_counts;
+        std::array<IntervalCounter, RESULT_BUCKET_COUNT> result_counts;
+    };
+
+    // Итоги окна - суммы счётчиков неистёкших интервалов. Пока истечение интервала и запись в него
+    // выполняются одновременно, итог может ненадолго уйти ниже нуля; читатель такие значения обнуляет.
+    struct WindowTotals
+    {
+        std::atomic<int64_t> request_count{0};
+        std::atomic<int64_t> no_result_count{0};
+        std::array<std::atomic<int64_t>, LATENCY_BUCKET_COUNT> latency_counts{};
+        std::array<std::atomic<int64_t>, RESULT_BUCKET_COUNT> result_counts{};
+    };
+
+    // Ячейка кольцевого буфера. Номер sequence нечётен, пока ячейка заполняется, и равен 2 * ticket + 2
+    // для заполненной ячейки записи с номером ticket; читатель проверяет, что номер не изменился за время чтения.
+    struct Slot
+    {
+        std::atomic<uint64_t> sequence{0};
+        std::atomic<int64_t> time_nanoseconds{0};
+        std::atomic<uint8_t> type{0};
+        std::atomic<int64_t> latency_nanoseconds{0};
+        std::atomic<uint64_t> result_count{0};
+    };
+
+    int64_t interval_nanoseconds_;
+    // Сдвиг окна при чтении логически не меняет журнал, поэтому интервалы и итоги изменяемы и в const-методах
+    mutable std::vector<Interval> intervals_;
+    mutable WindowTotals totals_;
+    mutable std::atomic<uint64_t> window_end_period_{NO_PERIOD}; // Последний интервал окна
+    std::vector<Slot> slots_;
+    std::atomic<uint64_t> next_ticket_{0};
+    std::atomic<uint64_t> total_count_{0};
+
+    // Номер интервала хранится полностью: при усечении до 32 бит ячейка интервала period % количество интервалов
+    // менялась бы скачком при переполнении номера
+    uint64_t GetPeriod(Clock::time_point time) const;
+    static size_t GetResultBucket(size_t result_count);
+    // Сдвигает окно так, чтобы оно оканчивалось не раньше интервала period, вычитая истёкшие интервалы из итогов
+    void AdvanceWindow(uint64_t period) const;
+    void ExpireInterval(Interval& interval, uint64_t last_expired_period) const;
+    void StoreRecent(const RequestRecord& record);
+};
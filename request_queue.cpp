@@ -1,3 +1,4 @@
+#include <chrono>
 #include <string>
 #include <vector>
 #include "document.h"
@@ -5,7 +6,8 @@
 
 using namespace std;
 
-RequestQueue::RequestQueue(const SearchServer& search_server) : linked_search_server(search_server)
+RequestQueue::RequestQueue(const SearchServer& search_server, chrono::seconds window)
+    : request_log_(window, RequestLog::DEFAULT_INTERVAL_COUNT), linked_search_server(search_server)
 {}
 
 // "переходники" для всех методов поиска, чтобы сохранять результаты для статистики
@@ -13,32 +15,42 @@ RequestQueue::RequestQueue(const SearchServer& search_server) : linked_search_se
 vector<Document> RequestQueue::AddFindRequest(const string& raw_query,
                                               DocumentStatus demand_status)
 {
-    vector<Document> request_resull;
-    request_resull = linked_search_server.FindTopDocuments(raw_query, demand_status);
-    AddRequestToQueue(RequestType::STATUS_REQUEST, raw_query, request_resull);
-    return request_resull;
+    const auto start = chrono::steady_clock::now();
+    vector<Document> request_result = linked_search_server.FindTopDocuments(raw_query, demand_status);
+    AddRequestToQueue(RequestType::STATUS_REQUEST, request_result, chrono::steady_clock::now() - start);
+    return request_result;
 }
 
 vector<Document> RequestQueue::AddFindRequest(const string& raw_query, FilterPred filter_pred)
 {
-    vector<Document> request_resull;
-    request_resull = linked_search_server.FindTopDocuments(raw_query, filter_pred);
-    AddRequestToQueue(RequestType::PREDICATE_REQUEST, raw_query, request_resull);
-    return request_resull;
+    const auto start = chrono::steady_clock::now();
+    vector<Document> request_result = linked_search_server.FindTopDocuments(raw_query, filter_pred);
+    AddRequestToQueue(RequestType::PREDICATE_REQUEST, request_result, chrono::steady_clock::now() - start);
+    return request_result;
+}
+
+void RequestQueue::AddRequestToQueue(RequestType request_type, const vector<Document>& request_result,
+                                     chrono::nanoseconds latency)
+{
+    request_log_.Record({RequestLog::Clock::now(), request_type, latency, request_result.size()});
 }
 
 void RequestQueue::AddRequestToQueue(RequestType request_type, const string& raw_query, vector<Document>& request_result)
 {
-    if (requests_.size() >= sec_in_day_)
-        requests_.pop_front();
-    requests_.push_back({request_type, request_result.size()});
+    AddRequestToQueue(request_type, request_result, chrono::nanoseconds(0));
 }
 
 int RequestQueue::GetNoResultRequests() const
 {
-    return count_if(requests_.begin(), requests_.end(),
-                    [](const QueryResult& qr) -> bool
-                    {
-                        return !qr.result_counter;
-                    });
+    return static_cast<int>(request_log_.GetNoResultCount());
+}
+
+RequestWindowStats RequestQueue::GetWindowStats() const
+{
+    return request_log_.GetWindowStats();
+}
+
+vector<RequestRecord> RequestQueue::GetRecentRequests() const
+{
+    return request_log_.GetRecentRequests();
 }
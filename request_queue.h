@@ -1,37 +1,33 @@
 #pragma once
+#include <chrono>
 #include <string>
 #include <vector>
-#include <deque>
 #include "document.h"
+#include "request_log.h"
 #include "search_server.h"
 
-enum class RequestType
-{
-    UNKNOWN_REQUEST = 0,
-    PREDICATE_REQUEST,
-    STATUS_REQUEST
-};
-
+//  ,    (. RequestLog).    
+//    .
 class RequestQueue
 {
 public:
-    explicit RequestQueue(const SearchServer& search_server);
+    explicit RequestQueue(const SearchServer& search_server, std::chrono::seconds window = RequestLog::DEFAULT_WINDOW);
     //  ""    ,     
     std::vector<Document> AddFindRequest(const std::string& raw_query,
                                          DocumentStatus demand_status = DocumentStatus::ACTUAL);
     std::vector<Document> AddFindRequest(const std::string& raw_query, FilterPred filter_pred);
 
+    void AddRequestToQueue(RequestType request_type, const std::vector<Document>& request_result,
+                           std::chrono::nanoseconds latency);
+    //    ,    ;    
     void AddRequestToQueue(RequestType request_type, const std::string& raw_query,
                            std::vector<Document>& request_result);
+    //       
     int GetNoResultRequests() const;
+    RequestWindowStats GetWindowStats() const;
+    std::vector<RequestRecord> GetRecentRequests() const;
 
 private:
-    struct QueryResult
-    {
-        RequestType request_type;
-        size_t result_counter;
-    };
-    std::deque<QueryResult> requests_;
-    const static int sec_in_day_ = 1440;
+    RequestLog request_log_;
     const SearchServer& linked_search_server;
 };
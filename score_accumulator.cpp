@@ -0,0 +1,54 @@
+#include <algorithm>
+#include "score_accumulator.h"
+
+using namespace std;
+
+namespace
+{
+    thread_local ScoreAccumulator thread_accumulator;
+    thread_local bool is_thread_accumulator_leased = false;
+}
+
+ScoreAccumulator::Lease::Lease()
+{
+    if (is_thread_accumulator_leased)
+    {
+        own_accumulator = make_unique<ScoreAccumulator>();
+        accumulator_ptr = own_accumulator.get();
+    }
+    else
+    {
+        is_thread_accumulator_leased = true;
+        accumulator_ptr = &thread_accumulator;
+    }
+}
+
+ScoreAccumulator::Lease::~Lease()
+{
+    if (!own_accumulator)
+        is_thread_accumulator_leased = false;
+}
+
+void ScoreAccumulator::Reset(size_t ordinal_count)
+{
+    if (scores_.size() < ordinal_count)
+    {
+        scores_.resize(ordinal_count);
+        stamps_.resize(ordinal_count, 0);
+    }
+    else if (scores_.size() >= MIN_SHRINK_SIZE && scores_.size() / SHRINK_RATIO > ordinal_count)
+    {
+        // Метки оставшихся ячеек относятся к прошлым эпохам, так что ячейки остаются пустыми
+        scores_.resize(ordinal_count);
+        scores_.shrink_to_fit();
+        stamps_.resize(ordinal_count);
+        stamps_.shrink_to_fit();
+    }
+    ++epoch_;
+    if (epoch_ == 0)
+    {
+        // Счётчик эпох переполнился - единственный случай, когда массив меток приходится очищать целиком
+        fill(stamps_.begin(), stamps_.end(), 0);
+        epoch_ = 1;
+    }
+}
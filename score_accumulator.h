@@ -0,0 +1,79 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Накопитель релевантностей документов при выполнении запроса. Представляет собой плоский массив,
+// адресуемый внутренним порядковым номером документа. Массив не очищается между запросами: каждая ячейка
+// помечена номером запроса (эпохой), в котором она была записана последний раз, поэтому ячейки,
+// оставшиеся от предыдущих запросов, считаются пустыми без явного обнуления.
+class ScoreAccumulator
+{
+public:
+    // Владеющая ссылка на накопитель потока. Если накопитель потока уже занят (например, поток,
+    // ожидающий завершения параллельного алгоритма, взял на исполнение другой запрос), выдаётся временный.
+    class Lease
+    {
+    public:
+        Lease();
+        ~Lease();
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+
+        ScoreAccumulator& operator*() const
+        {
+            return *accumulator_ptr;
+        }
+
+        ScoreAccumulator* operator->() const
+        {
+            return accumulator_ptr;
+        }
+
+    private:
+        std::unique_ptr<ScoreAccumulator> own_accumulator;
+        ScoreAccumulator *accumulator_ptr;
+    };
+
+    // Начинает новый запрос для документов с порядковыми номерами [0, ordinal_count). Массив, намного
+    // больший нужного (например, после перенумерации документов индекса), ужимается.
+    void Reset(size_t ordinal_count);
+
+    // Прибавляет score к релевантности документа, возвращает true при первом обращении к документу в запросе
+    bool Add(size_t ordinal, double score)
+    {
+        if (stamps_[ordinal] != epoch_)
+        {
+            stamps_[ordinal] = epoch_;
+            scores_[ordinal] = score;
+            return true;
+        }
+        scores_[ordinal] += score;
+        return false;
+    }
+
+    // Исключает документ из результатов текущего запроса
+    void Exclude(size_t ordinal)
+    {
+        stamps_[ordinal] = 0;
+    }
+
+    bool IsActive(size_t ordinal) const
+    {
+        return stamps_[ordinal] == epoch_;
+    }
+
+    double GetScore(size_t ordinal) const
+    {
+        return scores_[ordinal];
+    }
+
+private:
+    static constexpr size_t MIN_SHRINK_SIZE = 64 * 1024;
+    static constexpr size_t SHRINK_RATIO = 4;
+
+    std::vector<double> scores_;
+    std::vector<uint32_t> stamps_; // Эпоха последней записи ячейки, 0 - ячейка пуста
+    uint32_t epoch_ = 0;
+};
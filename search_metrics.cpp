@@ -0,0 +1,119 @@
+#include <algorithm>
+#include <string>
+#include "search_metrics.h"
+
+using namespace std;
+
+namespace
+{
+    const array<string_view, QUERY_PHASE_COUNT> PHASE_NAMES = {
+        "parse"sv, "term_lookup"sv, "posting_scan"sv, "minus_elimination"sv, "sort"sv, "result_build"sv
+    };
+
+    void WriteHistogram(ostream& out, string_view name, string_view labels, const LatencyHistogramSnapshot& histogram)
+    {
+        const string label_prefix = labels.empty() ? ""s : string(labels) + ","s;
+        uint64_t cumulative_count = 0;
+        for (size_t bucket = 0; bucket + 1 < LatencyHistogramSnapshot::BUCKET_COUNT; ++bucket)
+        {
+            cumulative_count += histogram.bucket_counts[bucket];
+            out << name << "_bucket{"s << label_prefix << "le=\""s
+                << LatencyHistogramSnapshot::GetBucketBound(bucket) * 1e-9 << "\"} "s << cumulative_count << '\n';
+        }
+        out << name << "_bucket{"s << label_prefix << "le=\"+Inf\"} "s << histogram.count << '\n';
+        const string label_block = labels.empty() ? ""s : "{"s + string(labels) + "}"s;
+        out << name << "_sum"s << label_block << ' ' << histogram.sum_nanoseconds * 1e-9 << '\n';
+        out << name << "_count"s << label_block << ' ' << histogram.count << '\n';
+    }
+}
+
+void LatencyHistogram::Record(uint64_t nanoseconds)
+{
+    size_t bucket = 0;
+    while (bucket + 1 < LatencyHistogramSnapshot::BUCKET_COUNT &&
+           nanoseconds > LatencyHistogramSnapshot::GetBucketBound(bucket))
+        ++bucket;
+    bucket_counts_[bucket].fetch_add(1, memory_order_relaxed);
+    sum_nanoseconds_.fetch_add(nanoseconds, memory_order_relaxed);
+    count_.fetch_add(1, memory_order_relaxed);
+}
+
+LatencyHistogramSnapshot LatencyHistogram::GetSnapshot() const
+{
+    LatencyHistogramSnapshot snapshot;
+    snapshot.count = count_.load(memory_order_relaxed);
+    snapshot.sum_nanoseconds = sum_nanoseconds_.load(memory_order_relaxed);
+    for (size_t bucket = 0; bucket < LatencyHistogramSnapshot::BUCKET_COUNT; ++bucket)
+        snapshot.bucket_counts[bucket] = bucket_counts_[bucket].load(memory_order_relaxed);
+    return snapshot;
+}
+
+void SearchMetrics::RecordQuery(string_view raw_query, const QueryTrace& trace)
+{
+    const int64_t total_nanoseconds =
+        chrono::duration_cast<chrono::nanoseconds>(QueryTrace::Clock::now() - trace.start_time).count();
+    query_latency_.Record(total_nanoseconds);
+    SlowQuery slow_query;
+    for (size_t phase = 0; phase < QUERY_PHASE_COUNT; ++phase)
+    {
+        // Этапы, которые запрос пропустил (например, при ответе из кэша), не учитываются
+        slow_query.phase_nanoseconds[phase] = trace.phase_nanoseconds[phase].load(memory_order_relaxed);
+        if (slow_query.phase_nanoseconds[phase] > 0)
+            phase_latencies_[phase].Record(slow_query.phase_nanoseconds[phase]);
+    }
+
+    if (total_nanoseconds < slow_query_threshold_nanoseconds_.load(memory_order_relaxed))
+        return;
+    slow_query.raw_query = raw_query;
+    slow_query.total_nanoseconds = total_nanoseconds;
+    lock_guard lock(slow_query_mutex_);
+    if (slow_queries_.size() == SLOW_QUERY_LOG_CAPACITY)
+        slow_queries_.pop_front();
+    slow_queries_.push_back(move(slow_query));
+}
+
+void SearchMetrics::SetSlowQueryThreshold(chrono::nanoseconds threshold)
+{
+    slow_query_threshold_nanoseconds_.store(threshold.count(), memory_order_relaxed);
+}
+
+void SearchMetrics::FillStats(SearchStats& stats) const
+{
+    stats.is_metrics_enabled = true;
+    stats.query_latency = query_latency_.GetSnapshot();
+    for (size_t phase = 0; phase < QUERY_PHASE_COUNT; ++phase)
+        stats.phase_latencies[phase] = phase_latencies_[phase].GetSnapshot();
+    lock_guard lock(slow_query_mutex_);
+    stats.slow_queries.assign(slow_queries_.begin(), slow_queries_.end());
+}
+
+void WriteStatsText(ostream& out, const SearchStats& stats)
+{
+    out << "# TYPE search_documents gauge\n"s << "search_documents "s << stats.document_count << '\n';
+    out << "# TYPE search_terms gauge\n"s << "search_terms "s << stats.term_count << '\n';
+    out << "# TYPE search_postings gauge\n"s << "search_postings "s << stats.posting_count << '\n';
+    out << "# TYPE search_term_arena_bytes gauge\n"s;
+    out << "search_term_arena_bytes{kind=\"reserved\"} "s << stats.term_arena_reserved_bytes << '\n';
+    out << "search_term_arena_bytes{kind=\"used\"} "s << stats.term_arena_used_bytes << '\n';
+    out << "search_term_arena_bytes{kind=\"live\"} "s << stats.term_arena_live_bytes << '\n';
+    if (!stats.is_metrics_enabled)
+        return;
+
+    out << "# TYPE search_query_duration_seconds histogram\n"s;
+    WriteHistogram(out, "search_query_duration_seconds"sv, ""sv, stats.query_latency);
+    out << "# TYPE search_query_phase_duration_seconds histogram\n"s;
+    for (size_t phase = 0; phase < QUERY_PHASE_COUNT; ++phase)
+        WriteHistogram(out, "search_query_phase_duration_seconds"sv, "phase=\""s + string(PHASE_NAMES[phase]) + "\""s,
+                       stats.phase_latencies[phase]);
+
+    for (const SlowQuery& slow_query : stats.slow_queries)
+    {
+        // Перевод строки в тексте запроса разорвал бы комментарий
+        string raw_query = slow_query.raw_query;
+        replace(raw_query.begin(), raw_query.end(), '\n', ' ');
+        out << "# slow query "s << slow_query.total_nanoseconds << "ns"s;
+        for (size_t phase = 0; phase < QUERY_PHASE_COUNT; ++phase)
+            out << ' ' << PHASE_NAMES[phase] << '=' << slow_query.phase_nanoseconds[phase] << "ns"s;
+        out << " ["s << raw_query << "]\n"s;
+    }
+}
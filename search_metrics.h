@@ -0,0 +1,143 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Этапы выполнения поискового запроса. При поиске с отсечением (MaxScore) отбор по минус-словам и
+// поддержание выдачи чередуются с обходом списков вхождений и учитываются в POSTING_SCAN.
+enum class QueryPhase
+{
+    PARSE,             // Разбор запроса
+    TERM_LOOKUP,       // Поиск списков вхождений и обратных частот слов
+    POSTING_SCAN,      // Обход списков вхождений плюс-слов
+    MINUS_ELIMINATION, // Исключение документов с минус-словами
+    SORT,              // Упорядочение и усечение выдачи
+    RESULT_BUILD       // Сборка выдачи из накопленных релевантностей
+};
+
+static constexpr size_t QUERY_PHASE_COUNT = static_cast<size_t>(QueryPhase::RESULT_BUILD) + 1;
+
+// Длительности этапов одного запроса. Этапы, выполняемые несколькими потоками, суммируются по потокам.
+struct QueryTrace
+{
+    using Clock = std::chrono::steady_clock;
+
+    Clock::time_point start_time;
+    std::array<std::atomic<uint64_t>, QUERY_PHASE_COUNT> phase_nanoseconds{};
+};
+
+// Замеряет этап запроса от создания до уничтожения объекта. При нулевом trace ничего не делает,
+// даже не читает часы, поэтому выключенные замеры ничего не стоят.
+class PhaseTimer
+{
+public:
+    PhaseTimer(QueryTrace* trace, QueryPhase phase) : trace_(trace), phase_(phase)
+    {
+        if (trace_)
+            start_time_ = QueryTrace::Clock::now();
+    }
+
+    PhaseTimer(const PhaseTimer&) = delete;
+    PhaseTimer& operator=(const PhaseTimer&) = delete;
+
+    ~PhaseTimer()
+    {
+        if (trace_)
+            trace_->phase_nanoseconds[static_cast<size_t>(phase_)].fetch_add(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(QueryTrace::Clock::now() - start_time_).count(),
+                std::memory_order_relaxed);
+    }
+
+private:
+    QueryTrace *trace_;
+    QueryPhase phase_;
+    QueryTrace::Clock::time_point start_time_;
+};
+
+// Гистограмма длительностей с корзинами, границы которых растут степенями двойки
+struct LatencyHistogramSnapshot
+{
+    static constexpr size_t BUCKET_COUNT = 28; // Последняя корзина не ограничена сверху
+    static constexpr size_t MIN_BOUND_LOG2 = 8; // Верхняя граница первой корзины - 256 нс
+
+    // Верхняя граница корзины bucket в наносекундах
+    static constexpr uint64_t GetBucketBound(size_t bucket)
+    {
+        return uint64_t(1) << (MIN_BOUND_LOG2 + bucket);
+    }
+
+    uint64_t count = 0;
+    uint64_t sum_nanoseconds = 0;
+    std::array<uint64_t, BUCKET_COUNT> bucket_counts{};
+};
+
+class LatencyHistogram
+{
+public:
+    void Record(uint64_t nanoseconds);
+    LatencyHistogramSnapshot GetSnapshot() const;
+
+private:
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> sum_nanoseconds_{0};
+    std::array<std::atomic<uint64_t>, LatencyHistogramSnapshot::BUCKET_COUNT> bucket_counts_{};
+};
+
+// Запрос, выполнявшийся дольше порога журнала медленных запросов
+struct SlowQuery
+{
+    std::string raw_query;
+    uint64_t total_nanoseconds = 0;
+    std::array<uint64_t, QUERY_PHASE_COUNT> phase_nanoseconds{};
+};
+
+// Снимок показателей поискового сервера (см. SearchServer::GetStats)
+struct SearchStats
+{
+    bool is_metrics_enabled = false;
+    // Показатели индекса собираются всегда
+    size_t document_count = 0;
+    size_t term_count = 0;
+    size_t posting_count = 0;
+    // Заполненность арены словаря (см. TermArenaStats)
+    size_t term_arena_reserved_bytes = 0;
+    size_t term_arena_used_bytes = 0;
+    size_t term_arena_live_bytes = 0;
+    // Показатели запросов собираются только при включённых замерах
+    LatencyHistogramSnapshot query_latency;
+    std::array<LatencyHistogramSnapshot, QUERY_PHASE_COUNT> phase_latencies;
+    std::vector<SlowQuery> slow_queries; // От давних к недавним
+};
+
+// Накопитель показателей запросов и журнал медленных запросов. Все операции потокобезопасны.
+class SearchMetrics
+{
+public:
+    static constexpr size_t SLOW_QUERY_LOG_CAPACITY = 100;
+    static constexpr std::chrono::nanoseconds DEFAULT_SLOW_QUERY_THRESHOLD = std::chrono::milliseconds(100);
+
+    // Учитывает завершившийся запрос; длительность запроса отсчитывается от trace.start_time
+    void RecordQuery(std::string_view raw_query, const QueryTrace& trace);
+    void SetSlowQueryThreshold(std::chrono::nanoseconds threshold);
+    // Заполняет показатели запросов в stats
+    void FillStats(SearchStats& stats) const;
+
+private:
+    LatencyHistogram query_latency_;
+    std::array<LatencyHistogram, QUERY_PHASE_COUNT> phase_latencies_;
+    std::atomic<int64_t> slow_query_threshold_nanoseconds_{DEFAULT_SLOW_QUERY_THRESHOLD.count()};
+    mutable std::mutex slow_query_mutex_;
+    std::deque<SlowQuery> slow_queries_;
+};
+
+// Выводит показатели в текстовом формате экспозиции Prometheus. Журнал медленных запросов
+// выводится комментариями после показателей.
+void WriteStatsText(std::ostream& out, const SearchStats& stats);
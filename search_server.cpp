@@ -1,64 +1,93 @@
 #include <string>
 #include <string_view>
 #include <numeric>
+#include <algorithm>
 #include <cmath>
 #include <stdexcept>
 #include <execution>
+#include <thread>
+#include <cstring>
 #include "search_server.h"
+#include "index_snapshot.h"
 
 using namespace std;
 
-const map<string_view, double> SearchServer::empty_word_freqs;
-
-SearchServer::SearchServer(const string_view stop_words_text)
-    : SearchServer(SplitIntoWordsString(stop_words_text))  // Делегирующий конструктор
+SearchServer::SearchServer(const string_view stop_words_text, pmr::memory_resource* memory_resource)
+    : SearchServer(SplitIntoWordsString(stop_words_text), memory_resource)  // Делегирующий конструктор
 {}
 
+SearchServer::SearchServer(const SearchServer& other)
+    : max_result_document_count(other.max_result_document_count), stop_words_(other.stop_words_),
+      words_collection_(other.words_collection_), word_to_document_freqs_(other.word_to_document_freqs_),
+      is_posting_compressed_(other.is_posting_compressed_), forward_index_(other.forward_index_),
+      document_ordinals_(other.document_ordinals_), document_ids_(other.document_ids_),
+      document_ids_by_ordinal_(other.document_ids_by_ordinal_), document_ratings_(other.document_ratings_),
+      document_statuses_(other.document_statuses_), document_lengths_(other.document_lengths_),
+      removal_mode_(other.removal_mode_), is_auto_ordinal_renumbering_(other.is_auto_ordinal_renumbering_),
+      removed_ordinals_(other.removed_ordinals_),
+      status_ordinals_(other.status_ordinals_), pending_removal_terms_(other.pending_removal_terms_),
+      pending_removal_count_(other.pending_removal_count_), index_epoch_(other.index_epoch_),
+      slow_query_threshold_(other.slow_query_threshold_)
+{
+    if (other.query_cache_)
+        query_cache_ = make_unique<QueryResultCache>(other.query_cache_->GetStats().capacity);
+    if (other.metrics_)
+        SetMetricsEnabled(true);
+}
+
+SearchServer& SearchServer::operator=(const SearchServer& other)
+{
+    if (this != &other)
+        *this = SearchServer(other);
+    return *this;
+}
+
 void SearchServer::AddDocument(int document_id, string_view document, DocumentStatus status,
                                const vector<int>& ratings)
 {
     if (document_id < 0)
         throw invalid_argument("Добавление документа : индекс документа вне пределов допустимого диапазона"s);
-    if (documents_.count(document_id))
+    if (document_ordinals_.count(document_id))
         throw invalid_argument("Добавление документа : документ с данным индексом уже добавлен ранее"s);
-    bool is_special_symbols;
-    const vector<string_view> words = SplitIntoWordsNoStop(document, &is_special_symbols);
-    if (is_special_symbols)
+    ParsedDocument parsed_document;
+    if (!ParseDocument(document, parsed_document))
        	throw invalid_argument("Добавление документа : документ содержит недопустимые символы"s);
-
-    const double inv_word_count = 1.0 / words.size();
-    map<string_view, double> word_freqs;
-    for (const string_view& word : words)
-    {
-        auto [wrd_col_it, is_added] = words_collection_.insert(static_cast<string>(word));
-        word_to_document_freqs_[*wrd_col_it][document_id] += inv_word_count;
-        word_freqs[*wrd_col_it] += inv_word_count;
-    }
-    documents_.emplace(document_id, DocumentData{ComputeAverageRating(ratings), status, word_freqs});
+    InsertDocument(document_id, status, ComputeAverageRating(ratings), parsed_document);
 }
 
 vector<Document> SearchServer::FindTopDocuments(const string_view raw_query,
                                   DocumentStatus demand_status) const
 {
-    return FindTopDocuments(execution::seq, raw_query,
-                            [demand_status](int document_id, DocumentStatus status, int rating) -> bool
-                            {return status == demand_status;});
+    return FindTopDocuments(execution::seq, raw_query, demand_status);
 }
 
-vector<Document> SearchServer::FindTopDocuments(const string_view raw_query,
-                                                FilterPred filter_pred) const
+vector<Document> SearchServer::FindTopDocumentsAfter(string_view raw_query, const Document& last_document,
+                                                    DocumentStatus demand_status) const
 {
-    return FindTopDocuments(execution::seq, raw_query, filter_pred);
+    return FindTopDocumentsAfter(execution::seq, raw_query, last_document, demand_status);
 }
 
 int SearchServer::GetDocumentCount() const
 {
-    return documents_.size();
+    return document_ordinals_.size();
 }
 
-tuple<vector<string_view>, DocumentStatus> SearchServer::MatchDocument(string_view raw_query, int document_id) const
+SearchServer::MatchedDocument SearchServer::MatchDocument(string_view raw_query, int document_id) const
 {
-    return SearchServer::MatchDocument(execution::seq, raw_query, document_id);
+    QueryError query_error = QueryError::NO_QUERY_ERROR;
+    const Query query = ParseQuery(raw_query, query_error);
+    TestQueryErrorCode(query_error);
+
+    const int ordinal = FindOrdinal(document_id);
+    if (ordinal == NO_ORDINAL)
+        throw out_of_range("Матчинг документов : неверный идентификатор документа"s);
+    return MatchOrdinal(query, ordinal);
+}
+
+vector<SearchServer::MatchedDocument> SearchServer::MatchDocuments(string_view raw_query,
+                                                                   const vector<int>& document_ids) const
+{
+    return MatchDocuments(execution::seq, raw_query, document_ids);
 }
 
 void SearchServer::TestQueryErrorCode(QueryError& query_error)
@@ -79,16 +108,127 @@ void SearchServer::TestQueryErrorCode(QueryError& query_error)
 
 bool SearchServer::IsStopWord(string_view word) const
 {
-    return stop_words_.count(word) > 0;
+    return stop_words_.Find(word) != TermDictionary::NO_TERM;
 }
 
-vector<string_view> SearchServer::SplitIntoWordsNoStop(const string_view& text, bool *is_special_symbols) const
+void SearchServer::SplitIntoWordsNoStop(string_view text, vector<string_view>& words, bool *is_special_symbols) const
 {
-    vector<string_view> words;
+    SplitIntoWords(text, words, is_special_symbols);
+    words.erase(remove_if(words.begin(), words.end(),
+                          [this](string_view word)
+                          {
+                              return IsStopWord(word);
+                          }),
+                words.end());
+}
 
-    for (const string_view& word : SplitIntoWords(text, is_special_symbols))
-        if (!IsStopWord(word)) words.push_back(word);
-    return words;
+void SearchServer::ReleaseEmptyTerms(const vector<TermId>& term_ids)
+{
+    for (const TermId term_id : term_ids)
+        if (word_to_document_freqs_[term_id].empty())
+        {
+            word_to_document_freqs_[term_id] = PostingList(is_posting_compressed_);
+            words_collection_.Release(term_id);
+        }
+}
+
+void SearchServer::CompactTermArenaIfSparse()
+{
+    const TermArenaStats arena_stats = words_collection_.GetArenaStats();
+    const size_t dead_bytes = arena_stats.used_bytes - arena_stats.live_bytes;
+    if (dead_bytes >= ARENA_COMPACTION_MIN_DEAD_BYTES && dead_bytes >= arena_stats.live_bytes)
+        CompactTermArena();
+}
+
+bool SearchServer::ParseDocument(string_view text, ParsedDocument& parsed_document) const
+{
+    // Буфер слов переиспользуется между вызовами, чтобы не выделять память под каждый документ
+    static thread_local vector<string_view> words;
+    bool is_special_symbols;
+    SplitIntoWordsNoStop(text, words, &is_special_symbols);
+    if (is_special_symbols)
+        return false;
+
+    sort(words.begin(), words.end());
+    parsed_document.length = words.size();
+    parsed_document.term_counts.clear();
+    for (auto word_it = words.begin(); word_it != words.end();)
+    {
+        const auto next_word_it = find_if(word_it + 1, words.end(),
+                                          [word = *word_it](string_view next_word)
+                                          {
+                                              return next_word != word;
+                                          });
+        parsed_document.term_counts.push_back({*word_it, static_cast<uint32_t>(next_word_it - word_it)});
+        word_it = next_word_it;
+    }
+    return true;
+}
+
+int SearchServer::FindOrdinal(int document_id) const
+{
+    const auto ordinal_it = document_ordinals_.find(document_id);
+    return ordinal_it == document_ordinals_.end() ? NO_ORDINAL : ordinal_it->second;
+}
+
+SearchServer::MatchedDocument SearchServer::MatchOrdinal(const Query& query, int ordinal) const
+{
+    // Слова запроса и записи прямого индекса упорядочены по идентификаторам слов, поэтому поиск каждого
+    // следующего слова продолжается с места, где остановился предыдущий
+    const ForwardEntries forward_entries = forward_index_.GetDocument(ordinal);
+    vector<string_view> matched_words;
+    const ForwardEntry *entry = forward_entries.begin();
+    for (const TermId term_id : query.minus_terms)
+    {
+        entry = forward_entries.SeekTerm(entry, term_id);
+        if (entry == forward_entries.end())
+            break;
+        if (entry->term_id == term_id)
+            return {matched_words, document_statuses_[ordinal]};
+    }
+
+    entry = forward_entries.begin();
+    for (const TermId term_id : query.plus_terms)
+    {
+        entry = forward_entries.SeekTerm(entry, term_id);
+        if (entry == forward_entries.end())
+            break;
+        if (entry->term_id == term_id)
+            matched_words.push_back(words_collection_.GetTerm(term_id));
+    }
+    sort(matched_words.begin(), matched_words.end());
+    return {matched_words, document_statuses_[ordinal]};
+}
+
+void SearchServer::InsertDocument(int document_id, DocumentStatus status, int rating, const ParsedDocument& parsed_document)
+{
+    const int ordinal = document_ids_by_ordinal_.size();
+    const uint32_t document_length = parsed_document.length;
+
+    // Каждое слово попадает в свой список вхождений один раз, вместе с количеством вхождений в документ.
+    // Записи прямого индекса собираются в буфер, переиспользуемый между вызовами.
+    static thread_local vector<ForwardEntry> forward_entries;
+    forward_entries.clear();
+    for (const auto& [word, term_count] : parsed_document.term_counts)
+    {
+        const TermId term_id = words_collection_.Intern(word);
+        if (term_id == word_to_document_freqs_.size())
+            word_to_document_freqs_.emplace_back(is_posting_compressed_);
+        word_to_document_freqs_[term_id].Add(ordinal, term_count, document_length);
+        forward_entries.push_back({term_id, term_count});
+    }
+    forward_index_.AddDocument(forward_entries);
+    document_ordinals_.emplace(document_id, ordinal);
+    document_ids_.insert(document_id);
+    document_ids_by_ordinal_.push_back(document_id);
+    document_lengths_.push_back(document_length);
+    document_ratings_.push_back(rating);
+    document_statuses_.push_back(status);
+    removed_ordinals_.Resize(document_ids_by_ordinal_.size());
+    for (OrdinalBitmap& status_ordinals : status_ordinals_)
+        status_ordinals.Resize(document_ids_by_ordinal_.size());
+    status_ordinals_[static_cast<size_t>(status)].Set(ordinal);
+    ++index_epoch_;
 }
 
 int SearchServer::ComputeAverageRating(const vector<int>& ratings)
@@ -125,7 +265,8 @@ SearchServer::Query SearchServer::ParseQuery(string_view text, QueryError& query
     bool is_special_symbols = false;
     query_error = QueryError::NO_QUERY_ERROR;
 
-    auto words = SplitIntoWords(text, &is_special_symbols);
+    static thread_local vector<string_view> words;
+    SplitIntoWords(text, words, &is_special_symbols);
     if (is_special_symbols)
     {
         query_error = QueryError::CONTAINS_SPECIAL_SYMBOLS;
@@ -140,27 +281,119 @@ SearchServer::Query SearchServer::ParseQuery(string_view text, QueryError& query
             query_error = query_word_error;
             return query;
         }
-        if (!query_word.is_stop)
-        {
-            if (query_word.is_minus)
-                query.minus_words.insert(query_word.data);
-            else
-                query.plus_words.insert(query_word.data);
-        }
+        if (query_word.is_stop)
+            continue;
+        const TermId term_id = words_collection_.Find(query_word.data);
+        if (term_id == TermDictionary::NO_TERM)
+            continue;
+        if (query_word.is_minus)
+            query.minus_terms.push_back(term_id);
+        else
+            query.plus_terms.push_back(term_id);
+    }
+    for (vector<TermId>* terms : {&query.plus_terms, &query.minus_terms})
+    {
+        sort(terms->begin(), terms->end());
+        terms->erase(unique(terms->begin(), terms->end()), terms->end());
     }
     return query;
 }
 
-double SearchServer::ComputeWordInverseDocumentFreq(const string_view& word) const
+vector<pair<int, int>> SearchServer::SplitOrdinalRange(bool is_parallel) const
+{
+    const int ordinal_count = document_ids_by_ordinal_.size();
+    int range_count = 1;
+    if (is_parallel)
+        range_count = max(1, min(static_cast<int>(thread::hardware_concurrency()) * 4,
+                                 ordinal_count / MIN_ORDINAL_RANGE_SIZE));
+
+    vector<pair<int, int>> ordinal_ranges;
+    ordinal_ranges.reserve(range_count);
+    for (int i = 0; i < range_count; ++i)
+        ordinal_ranges.push_back({static_cast<int>(static_cast<long long>(ordinal_count) * i / range_count),
+                                  static_cast<int>(static_cast<long long>(ordinal_count) * (i + 1) / range_count)});
+    return ordinal_ranges;
+}
+
+SearchServer::QueryPostings SearchServer::GetQueryPostings(const Query& query, QueryTrace* trace) const
+{
+    const PhaseTimer phase_timer(trace, QueryPhase::TERM_LOOKUP);
+    QueryPostings query_postings;
+    for (const TermId term_id : query.plus_terms)
+        if (word_to_document_freqs_[term_id].GetDocumentCount())
+            query_postings.plus_postings.push_back({&word_to_document_freqs_[term_id], ComputeWordInverseDocumentFreq(term_id)});
+    for (const TermId term_id : query.minus_terms)
+        if (word_to_document_freqs_[term_id].GetDocumentCount())
+            query_postings.minus_postings.push_back(&word_to_document_freqs_[term_id]);
+    return query_postings;
+}
+
+SearchServer::QueryBatch SearchServer::PlanQueryBatch(vector<Query> queries, DocumentStatus demand_status) const
+{
+    QueryBatch batch;
+    batch.task_by_text.reserve(queries.size());
+    unordered_map<QueryCacheKey, size_t, QueryCacheKeyHasher> task_by_key;
+    for (Query& query : queries)
+    {
+        QueryCacheKey key{move(query.plus_terms), move(query.minus_terms), demand_status, max_result_document_count};
+        const auto [task_it, is_inserted] = task_by_key.emplace(key, batch.task_keys.size());
+        if (is_inserted)
+            batch.task_keys.push_back(move(key));
+        batch.task_by_text.push_back(task_it->second);
+    }
+
+    batch.task_postings.reserve(batch.task_keys.size());
+    batch.task_costs.reserve(batch.task_keys.size());
+    for (const QueryCacheKey& key : batch.task_keys)
+    {
+        QueryPostings query_postings = GetQueryPostings({key.plus_terms, key.minus_terms});
+        batch.task_costs.push_back(CountCandidates(query_postings));
+        batch.task_postings.push_back(move(query_postings));
+    }
+    return batch;
+}
+
+size_t SearchServer::CountCandidates(const QueryPostings& query_postings)
 {
-    return log(GetDocumentCount() * 1.0 / word_to_document_freqs_.at(word).size());
+    size_t candidate_count = 0;
+    for (const auto& [posting_list_ptr, _] : query_postings.plus_postings)
+        candidate_count += posting_list_ptr->size();
+    return candidate_count;
+}
+
+bool SearchServer::IsMoreRelevant(const Document& lhs, const Document& rhs)
+{
+    if (abs(lhs.relevance - rhs.relevance) < RELEVANCE_TOLERANCE)
+    {
+        if (lhs.rating != rhs.rating)
+            return lhs.rating > rhs.rating;
+        return lhs.id < rhs.id;
+    }
+    return lhs.relevance > rhs.relevance;
+}
+
+double SearchServer::ComputeWordInverseDocumentFreq(TermId term_id) const
+{
+    const PostingList& posting_list = word_to_document_freqs_[term_id];
+    if (const optional<double> inverse_document_freq = posting_list.FindInverseDocumentFreq(index_epoch_))
+        return *inverse_document_freq;
+    const double inverse_document_freq = log(GetDocumentCount() * 1.0 / posting_list.GetDocumentCount());
+    posting_list.StoreInverseDocumentFreq(index_epoch_, inverse_document_freq);
+    return inverse_document_freq;
+}
+
+void SearchServer::PrecomputeInverseDocumentFreqs() const
+{
+    for (TermId term_id = 0; term_id < word_to_document_freqs_.size(); ++term_id)
+        if (word_to_document_freqs_[term_id].GetDocumentCount())
+            ComputeWordInverseDocumentFreq(term_id);
 }
 
 SearchServer::iterator::iterator(const SearchServer *searchserver_ptr, bool begin_or_end) :
                                 linked_search_server_ptr(searchserver_ptr)
 {
-    documents_it = begin_or_end ? linked_search_server_ptr->documents_.begin()
-                                : linked_search_server_ptr->documents_.end();
+    documents_it = begin_or_end ? linked_search_server_ptr->document_ids_.begin()
+                                : linked_search_server_ptr->document_ids_.end();
 }
 
 SearchServer::iterator& SearchServer::iterator::operator++()
@@ -202,7 +435,7 @@ bool SearchServer::iterator::operator!=(const SearchServer::iterator& second_op_
 
 const int& SearchServer::iterator::operator*() const
 {
-    return documents_it->first;
+    return *documents_it;
 }
 
 SearchServer::iterator SearchServer::begin() const
@@ -215,12 +448,12 @@ SearchServer::iterator SearchServer::end() const
     return SearchServer::iterator(this, false);
 }
 
-const map<string_view, double>& SearchServer::GetWordFrequencies(int document_id) const
+WordFrequencies SearchServer::GetWordFrequencies(int document_id) const
 {
-    if (documents_.count(document_id))
-        return documents_.at(document_id).word_freqs;
-    else
-        return empty_word_freqs;
+    const int ordinal = FindOrdinal(document_id);
+    if (ordinal == NO_ORDINAL)
+        return WordFrequencies();
+    return WordFrequencies(words_collection_, forward_index_.GetDocument(ordinal), document_lengths_[ordinal]);
 }
 
 void SearchServer::RemoveDocument(int document_id)
@@ -228,6 +461,148 @@ void SearchServer::RemoveDocument(int document_id)
     SearchServer::RemoveDocument(execution::seq, document_id);
 }
 
+vector<int> SearchServer::RenumberDocumentOrdinals()
+{
+    // Новый номер документа не больше прежнего, поэтому массивы уплотняются на месте
+    vector<int> new_ordinals(document_ids_by_ordinal_.size(), NO_ORDINAL);
+    size_t ordinal_count = 0;
+    for (size_t ordinal = 0; ordinal < document_ids_by_ordinal_.size(); ++ordinal)
+    {
+        const int document_id = document_ids_by_ordinal_[ordinal];
+        if (document_id == REMOVED_DOCUMENT_ID)
+            continue;
+        new_ordinals[ordinal] = ordinal_count;
+        document_ids_by_ordinal_[ordinal_count] = document_id;
+        document_ratings_[ordinal_count] = document_ratings_[ordinal];
+        document_statuses_[ordinal_count] = document_statuses_[ordinal];
+        document_lengths_[ordinal_count] = document_lengths_[ordinal];
+        document_ordinals_[document_id] = ordinal_count;
+        ++ordinal_count;
+    }
+    document_ids_by_ordinal_.resize(ordinal_count);
+    document_ids_by_ordinal_.shrink_to_fit();
+    document_ratings_.resize(ordinal_count);
+    document_ratings_.shrink_to_fit();
+    document_statuses_.resize(ordinal_count);
+    document_statuses_.shrink_to_fit();
+    document_lengths_.resize(ordinal_count);
+    document_lengths_.shrink_to_fit();
+    forward_index_.RenumberDocuments(new_ordinals);
+
+    removed_ordinals_.Clear();
+    removed_ordinals_.Resize(ordinal_count);
+    for (OrdinalBitmap& status_ordinals : status_ordinals_)
+    {
+        status_ordinals.Clear();
+        status_ordinals.Resize(ordinal_count);
+    }
+    for (size_t ordinal = 0; ordinal < ordinal_count; ++ordinal)
+        status_ordinals_[static_cast<size_t>(document_statuses_[ordinal])].Set(ordinal);
+    return new_ordinals;
+}
+
+void SearchServer::CompactTermArena()
+{
+    // Индекс хранит слова только идентификаторами, поэтому уплотнение словаря его не затрагивает
+    words_collection_.CompactArena();
+}
+
+void SearchServer::SetRemovalMode(RemovalMode removal_mode)
+{
+    removal_mode_ = removal_mode;
+}
+
+RemovalMode SearchServer::GetRemovalMode() const
+{
+    return removal_mode_;
+}
+
+void SearchServer::SetAutoOrdinalRenumbering(bool is_enabled)
+{
+    is_auto_ordinal_renumbering_ = is_enabled;
+}
+
+bool SearchServer::IsAutoOrdinalRenumbering() const
+{
+    return is_auto_ordinal_renumbering_;
+}
+
+int SearchServer::GetPendingRemovalCount() const
+{
+    return pending_removal_count_;
+}
+
+void SearchServer::CompactIndex()
+{
+    SearchServer::CompactIndex(execution::seq);
+}
+
+void SearchServer::SetPostingCompression(bool is_compressed)
+{
+    SearchServer::SetPostingCompression(execution::seq, is_compressed);
+}
+
+bool SearchServer::IsPostingCompressed() const
+{
+    return is_posting_compressed_;
+}
+
+void SearchServer::SetQueryCacheCapacity(size_t capacity)
+{
+    if (capacity == 0)
+        query_cache_.reset();
+    else if (query_cache_)
+        query_cache_->SetCapacity(capacity);
+    else
+        query_cache_ = make_unique<QueryResultCache>(capacity);
+}
+
+QueryCacheStats SearchServer::GetQueryCacheStats() const
+{
+    return query_cache_ ? query_cache_->GetStats() : QueryCacheStats();
+}
+
+void SearchServer::SetMetricsEnabled(bool is_enabled)
+{
+    if (!is_enabled)
+    {
+        metrics_.reset();
+    }
+    else if (!metrics_)
+    {
+        metrics_ = make_unique<SearchMetrics>();
+        metrics_->SetSlowQueryThreshold(slow_query_threshold_);
+    }
+}
+
+bool SearchServer::IsMetricsEnabled() const
+{
+    return metrics_ != nullptr;
+}
+
+void SearchServer::SetSlowQueryThreshold(chrono::nanoseconds threshold)
+{
+    slow_query_threshold_ = threshold;
+    if (metrics_)
+        metrics_->SetSlowQueryThreshold(threshold);
+}
+
+SearchStats SearchServer::GetStats() const
+{
+    SearchStats stats;
+    stats.document_count = document_ordinals_.size();
+    stats.term_count = words_collection_.size();
+    const TermArenaStats arena_stats = words_collection_.GetArenaStats();
+    stats.term_arena_reserved_bytes = arena_stats.reserved_bytes;
+    stats.term_arena_used_bytes = arena_stats.used_bytes;
+    stats.term_arena_live_bytes = arena_stats.live_bytes;
+    for (const PostingList& posting_list : word_to_document_freqs_)
+        stats.posting_count += posting_list.GetDocumentCount();
+    if (metrics_)
+        metrics_->FillStats(stats);
+    return stats;
+}
+
 int SearchServer::GetSetResultDocumentCount(int new_result_document_count) const
 {
     int old_result_document_count = max_result_document_count;
@@ -237,3 +612,210 @@ int SearchServer::GetSetResultDocumentCount(int new_result_document_count) const
     return old_result_document_count;
 
 }
+
+void SearchServer::SaveSnapshot(const string& path) const
+{
+    static_assert(sizeof(int) == sizeof(int32_t), "Снимок индекса рассчитан на 32-битный int");
+
+    // Документы: порядковые номера перенумеровываются подряд с сохранением порядка
+    vector<int> saved_ordinals(document_ids_by_ordinal_.size(), REMOVED_DOCUMENT_ID);
+    vector<int> document_ids;
+    vector<int> ratings;
+    vector<uint8_t> statuses;
+    vector<uint32_t> document_lengths;
+    for (size_t ordinal = 0; ordinal < document_ids_by_ordinal_.size(); ++ordinal)
+    {
+        const int document_id = document_ids_by_ordinal_[ordinal];
+        if (document_id == REMOVED_DOCUMENT_ID)
+            continue;
+        saved_ordinals[ordinal] = document_ids.size();
+        document_ids.push_back(document_id);
+        ratings.push_back(document_ratings_[ordinal]);
+        statuses.push_back(static_cast<uint8_t>(document_statuses_[ordinal]));
+        document_lengths.push_back(document_lengths_[ordinal]);
+    }
+
+    // Слова: в снимок попадают слова, у которых остались действующие документы
+    vector<uint32_t> saved_term_indexes(word_to_document_freqs_.size(), TermDictionary::NO_TERM);
+    vector<string_view> terms;
+    vector<TermId> term_ids;
+    for (TermId term_id = 0; term_id < word_to_document_freqs_.size(); ++term_id)
+        if (word_to_document_freqs_[term_id].GetDocumentCount())
+        {
+            saved_term_indexes[term_id] = terms.size();
+            terms.push_back(words_collection_.GetTerm(term_id));
+            term_ids.push_back(term_id);
+        }
+
+    // Прямой индекс: для каждого документа - номера его слов в снимке и количества их вхождений
+    vector<uint64_t> forward_offsets = {0};
+    vector<uint32_t> forward_terms;
+    vector<uint32_t> forward_counts;
+    for (size_t i = 0; i < document_ids.size(); ++i)
+    {
+        for (const ForwardEntry& entry : forward_index_.GetDocument(document_ordinals_.at(document_ids[i])))
+        {
+            forward_terms.push_back(saved_term_indexes[entry.term_id]);
+            forward_counts.push_back(entry.term_count);
+        }
+        forward_offsets.push_back(forward_terms.size());
+    }
+
+    SnapshotWriter writer(path);
+    writer.WriteArray(SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    writer.Write(SNAPSHOT_VERSION);
+    writer.Write<uint32_t>(0); // Зарезервировано
+    writer.WriteStrings(stop_words_.GetTerms());
+    writer.WriteStrings(terms);
+
+    writer.Write<uint64_t>(document_ids.size());
+    writer.WriteArray(document_ids);
+    writer.WriteArray(ratings);
+    writer.WriteArray(statuses);
+    writer.WriteArray(document_lengths);
+    writer.WriteArray(forward_offsets);
+    writer.WriteArray(forward_terms);
+    writer.WriteArray(forward_counts);
+
+    // Списки вхождений: длины списков, затем для каждого слова - массивы порядковых номеров и количеств вхождений
+    vector<uint64_t> posting_counts;
+    posting_counts.reserve(term_ids.size());
+    for (const TermId term_id : term_ids)
+        posting_counts.push_back(word_to_document_freqs_[term_id].GetDocumentCount());
+    writer.WriteArray(posting_counts);
+    vector<int> posting_ordinals;
+    vector<uint32_t> posting_term_counts;
+    for (const TermId term_id : term_ids)
+    {
+        posting_ordinals.clear();
+        posting_term_counts.clear();
+        for (PostingList::Cursor cursor(word_to_document_freqs_[term_id]); cursor.GetDocumentId() != PostingList::NO_DOCUMENT;
+             cursor.Next())
+            if (saved_ordinals[cursor.GetDocumentId()] != REMOVED_DOCUMENT_ID)
+            {
+                posting_ordinals.push_back(saved_ordinals[cursor.GetDocumentId()]);
+                posting_term_counts.push_back(cursor.GetTermCount());
+            }
+        writer.WriteArray(posting_ordinals);
+        writer.WriteArray(posting_term_counts);
+    }
+    writer.Finish();
+}
+
+void SearchServer::LoadSnapshot(const string& path)
+{
+    const MappedFile file(path);
+    SnapshotReader reader(file);
+
+    char magic[sizeof(SNAPSHOT_MAGIC)];
+    reader.ReadArray(magic, sizeof(magic));
+    if (memcmp(magic, SNAPSHOT_MAGIC, sizeof(magic)) != 0)
+        throw invalid_argument("Снимок индекса : файл не является снимком индекса"s);
+    if (reader.Read<uint32_t>() != SNAPSHOT_VERSION)
+        throw invalid_argument("Снимок индекса : неподдерживаемая версия формата"s);
+    reader.Read<uint32_t>();
+
+    // Индекс собирается отдельно и подменяет текущий только после успешного чтения всего снимка
+    SearchServer loaded_server(""sv, words_collection_.GetMemoryResource());
+    loaded_server.max_result_document_count = max_result_document_count;
+    loaded_server.removal_mode_ = removal_mode_;
+    loaded_server.is_auto_ordinal_renumbering_ = is_auto_ordinal_renumbering_;
+    loaded_server.is_posting_compressed_ = is_posting_compressed_;
+
+    for (const string_view stop_word : reader.ReadStrings())
+    {
+        if (stop_word.empty())
+            throw invalid_argument("Снимок индекса : пустое стоп-слово"s);
+        loaded_server.stop_words_.Intern(stop_word);
+    }
+    const vector<string_view> terms = reader.ReadStrings();
+    for (size_t i = 0; i < terms.size(); ++i)
+    {
+        if (terms[i].empty())
+            throw invalid_argument("Снимок индекса : пустое слово в словаре"s);
+        if (loaded_server.words_collection_.Intern(terms[i]) != i)
+            throw invalid_argument("Снимок индекса : повторяющиеся слова в словаре"s);
+    }
+    loaded_server.word_to_document_freqs_.resize(terms.size(), PostingList(is_posting_compressed_));
+
+    const uint64_t document_count = reader.Read<uint64_t>();
+    const vector<int> document_ids = reader.ReadArray<int>(document_count);
+    vector<int> ratings = reader.ReadArray<int>(document_count);
+    const vector<uint8_t> statuses = reader.ReadArray<uint8_t>(document_count);
+    vector<uint32_t> document_lengths = reader.ReadArray<uint32_t>(document_count);
+    const vector<uint64_t> forward_offsets = reader.ReadArray<uint64_t>(document_count + 1);
+    const vector<uint32_t> forward_terms = reader.ReadArray<uint32_t>(forward_offsets.back());
+    const vector<uint32_t> forward_counts = reader.ReadArray<uint32_t>(forward_offsets.back());
+
+    loaded_server.document_ordinals_.reserve(document_count);
+    loaded_server.document_ids_by_ordinal_.reserve(document_count);
+    loaded_server.document_statuses_.reserve(document_count);
+    vector<ForwardEntry> forward_entries;
+    // Для каждого слова - количество документов, в прямом индексе которых оно встречается
+    vector<uint64_t> term_document_counts(terms.size());
+    for (OrdinalBitmap& status_ordinals : loaded_server.status_ordinals_)
+        status_ordinals.Resize(document_count);
+    for (size_t ordinal = 0; ordinal < document_count; ++ordinal)
+    {
+        if (document_ids[ordinal] < 0 || statuses[ordinal] > static_cast<uint8_t>(DocumentStatus::REMOVED) ||
+            forward_offsets[ordinal] > forward_offsets[ordinal + 1] || forward_offsets[ordinal + 1] > forward_offsets.back())
+            throw invalid_argument("Снимок индекса : повреждены данные документа"s);
+        // Номера слов в снимке совпадают с их идентификаторами в загружаемом словаре
+        forward_entries.clear();
+        for (size_t i = forward_offsets[ordinal]; i < forward_offsets[ordinal + 1]; ++i)
+        {
+            if (forward_terms[i] >= terms.size() || forward_counts[i] == 0 || forward_counts[i] > document_lengths[ordinal])
+                throw invalid_argument("Снимок индекса : повреждён прямой индекс"s);
+            forward_entries.push_back({forward_terms[i], forward_counts[i]});
+            ++term_document_counts[forward_terms[i]];
+        }
+        loaded_server.forward_index_.AddDocument(forward_entries);
+        const ForwardEntries document_entries = loaded_server.forward_index_.GetDocument(ordinal);
+        if (adjacent_find(document_entries.begin(), document_entries.end(),
+                          [](const ForwardEntry& lhs, const ForwardEntry& rhs)
+                          {
+                              return lhs.term_id == rhs.term_id;
+                          }) != document_entries.end())
+            throw invalid_argument("Снимок индекса : повреждён прямой индекс"s);
+        if (!loaded_server.document_ordinals_.emplace(document_ids[ordinal], static_cast<int>(ordinal)).second)
+            throw invalid_argument("Снимок индекса : повторяющиеся индексы документов"s);
+        loaded_server.document_ids_.insert(document_ids[ordinal]);
+        loaded_server.document_ids_by_ordinal_.push_back(document_ids[ordinal]);
+        loaded_server.document_statuses_.push_back(static_cast<DocumentStatus>(statuses[ordinal]));
+        loaded_server.status_ordinals_[statuses[ordinal]].Set(ordinal);
+    }
+    loaded_server.document_lengths_ = move(document_lengths);
+    loaded_server.document_ratings_ = move(ratings);
+    loaded_server.removed_ordinals_.Resize(document_count);
+
+    // Списки вхождений должны в точности совпадать с прямым индексом: в списке слова - все документы,
+    // в прямом индексе которых есть это слово, и с теми же количествами вхождений. Вместе с возрастанием
+    // порядковых номеров равенство длин исключает как лишние, так и недостающие вхождения.
+    const vector<uint64_t> posting_counts = reader.ReadArray<uint64_t>(terms.size());
+    for (size_t i = 0; i < terms.size(); ++i)
+    {
+        if (posting_counts[i] != term_document_counts[i])
+            throw invalid_argument("Снимок индекса : повреждён список вхождений"s);
+        vector<int> posting_ordinals = reader.ReadArray<int>(posting_counts[i]);
+        vector<uint32_t> posting_term_counts = reader.ReadArray<uint32_t>(posting_counts[i]);
+        for (size_t j = 0; j < posting_ordinals.size(); ++j)
+        {
+            if (posting_ordinals[j] < 0 || static_cast<uint64_t>(posting_ordinals[j]) >= document_count ||
+                (j > 0 && posting_ordinals[j - 1] >= posting_ordinals[j]))
+                throw invalid_argument("Снимок индекса : повреждён список вхождений"s);
+            const ForwardEntries document_entries = loaded_server.forward_index_.GetDocument(posting_ordinals[j]);
+            const ForwardEntry* entry = document_entries.SeekTerm(document_entries.begin(), static_cast<TermId>(i));
+            if (entry == document_entries.end() || entry->term_id != i || entry->term_count != posting_term_counts[j])
+                throw invalid_argument("Снимок индекса : повреждён список вхождений"s);
+        }
+        loaded_server.word_to_document_freqs_[i].Assign(move(posting_ordinals), move(posting_term_counts),
+                                                        loaded_server.document_lengths_);
+    }
+
+    // Кэш результатов переходит к новому индексу; новая эпоха делает прежние записи недействительными
+    loaded_server.index_epoch_ = index_epoch_ + 1;
+    loaded_server.query_cache_ = move(query_cache_);
+    loaded_server.metrics_ = move(metrics_);
+    loaded_server.slow_query_threshold_ = slow_query_threshold_;
+    *this = move(loaded_server);
+}
@@ -1,18 +1,35 @@
 #pragma once
+#include <array>
+#include <chrono>
 #include <string>
 #include <string_view>
 #include <vector>
-#include <set>
 #include <map>
 #include <functional>
 #include <stdexcept>
 #include <iterator>
+#include <exception>
 #include <execution>
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
 #include "document.h"
+#include "forward_index.h"
 #include "paginator.h"
 #include "string_processing.h"
 #include "log_duration.h"
-#include "concurrent_map.h"
+#include "posting_list.h"
+#include "query_cache.h"
+#include "search_metrics.h"
+#include "score_accumulator.h"
+#include "term_dictionary.h"
 
 enum class QueryError
 {
@@ -22,16 +39,42 @@ enum class QueryError
     CONTAINS_SPECIAL_SYMBOLS
 };
 
+// Результат добавления документа в составе пакета (см. SearchServer::AddDocuments)
+enum class AddDocumentError
+{
+    NO_ADD_DOCUMENT_ERROR = 0,
+    INVALID_DOCUMENT_ID,
+    DUPLICATE_DOCUMENT_ID,
+    CONTAINS_SPECIAL_SYMBOLS
+};
+
+// Документ для пакетного добавления. Текст документа должен оставаться действительным до конца добавления.
+struct DocumentToAdd
+{
+    int id;
+    std::string_view text;
+    DocumentStatus status;
+    std::vector<int> ratings;
+};
+
 using FilterPred = std::function<bool(int, DocumentStatus, int)>;
 
+// Способ удаления документов
+enum class RemovalMode
+{
+    IMMEDIATE, // Документ сразу вычёркивается из всех списков вхождений своих слов
+    DEFERRED   // Документ помечается удалённым, списки вхождений уплотняются позже, пакетом (см. CompactIndex)
+};
+
 class SearchServer
 {
 private:
-    struct DocumentData
+    // Документ, разобранный для добавления в индекс: слова без стоп-слов, упорядоченные по возрастанию,
+    // с количествами их вхождений, и длина документа
+    struct ParsedDocument
     {
-        int rating;
-        DocumentStatus status;
-        std::map<std::string_view, double> word_freqs; //Список слов документа и их обратных частот
+        std::vector<std::pair<std::string_view, uint32_t>> term_counts;
+        uint32_t length = 0;
     };
 
     struct QueryWord
@@ -41,151 +84,580 @@ private:
         bool is_stop;
     };
 
+    // Запрос в виде упорядоченных идентификаторов слов. Слова, отсутствующие в словаре, ни в одном документе
+    // не встречаются и на результат не влияют, поэтому в запрос не попадают.
     struct Query
     {
-        std::set<std::string_view> plus_words;
-        std::set<std::string_view> minus_words;
+        std::vector<TermId> plus_terms;
+        std::vector<TermId> minus_terms;
+    };
+
+    // Списки вхождений слов запроса, найденных в индексе
+    struct QueryPostings
+    {
+        std::vector<std::pair<const PostingList*, double>> plus_postings; // Списки плюс-слов и их обратные частоты
+        std::vector<const PostingList*> minus_postings;
+    };
+
+    // Предикат отбора документов: bool(int document_id, DocumentStatus status, int rating)
+    template <class DocumentPredicate>
+    static constexpr bool IsDocumentPredicate()
+    {
+        return std::is_invocable_r_v<bool, const DocumentPredicate&, int, DocumentStatus, int>;
+    }
+
+    // Пакет запросов, подготовленный к выполнению. Задача - один из различных разобранных запросов пакета.
+    struct QueryBatch
+    {
+        std::vector<size_t> task_by_text; // Номер задачи для каждого различного текста запроса
+        std::vector<QueryCacheKey> task_keys;
+        std::vector<QueryPostings> task_postings;
+        std::vector<size_t> task_costs; // Оценка трудоёмкости задачи
+    };
+
+    // Курсор по списку вхождений плюс-слова в пределах отрезка порядковых номеров документов
+    struct TermCursor
+    {
+        PostingList::Cursor posting_cursor;
+        double inverse_document_freq;
+        double max_score; // Верхняя граница вклада слова в релевантность документа
+        size_t query_index; // Номер слова в запросе, задающий порядок суммирования вкладов
+
+        int GetOrdinal() const
+        {
+            return posting_cursor.GetDocumentId();
+        }
     };
 
 public:
 
+    // Слова словарей сервера размещаются в блоках, выделяемых из memory_resource (см. TermDictionary).
+    // Ресурс памяти должен существовать дольше сервера; обращения к нему выполняются только при изменении индекса.
     template <template <typename ValueType> typename Container>
-    explicit SearchServer(const Container<std::string>& text)
+    explicit SearchServer(const Container<std::string>& text,
+                          std::pmr::memory_resource* memory_resource = std::pmr::get_default_resource())
+        : stop_words_(memory_resource), words_collection_(memory_resource), forward_index_(memory_resource)
     {
         using std::operator""s;
         for (const std::string& word : text)
         {
             for (const unsigned char c : word)
                 if (c < SPECIAL_SYMBOLS_MARGIN) throw std::invalid_argument("Стоп-слова : стоп-слово содержит недопустимые символы"s);
-            if (!word.empty()) stop_words_.insert(word);
+            if (!word.empty()) stop_words_.Intern(word);
         }
     }
 
-    explicit SearchServer(std::string_view stop_words_text);
+    explicit SearchServer(std::string_view stop_words_text,
+                          std::pmr::memory_resource* memory_resource = std::pmr::get_default_resource());
+
+    // Копия получает тот же индекс и те же настройки, но пустой кэш результатов той же ёмкости
+    // и, если замеры включены, новые замеры без накопленных показателей
+    SearchServer(const SearchServer& other);
+    SearchServer& operator=(const SearchServer& other);
+    SearchServer(SearchServer&&) = default;
+    SearchServer& operator=(SearchServer&&) = default;
 
     void AddDocument(int document_id, std::string_view document, DocumentStatus status,
                                    const std::vector<int>& ratings);
 
+    // Добавляет пакет документов. Разбор текстов и подсчёт слов выполняются параллельно (для параллельной
+    // политики) и не затрагивают индекс; затем разобранные документы вливаются в индекс за один проход в
+    // порядке пакета. Вместо исключения для каждого документа возвращается код ошибки, документы с ошибками
+    // пропускаются.
+    template <class ExecutionPolicy>
+    std::vector<AddDocumentError> AddDocuments(ExecutionPolicy&& policy, const std::vector<DocumentToAdd>& documents)
+    {
+        std::vector<ParsedDocument> parsed_documents(documents.size());
+        std::vector<AddDocumentError> errors(documents.size(), AddDocumentError::NO_ADD_DOCUMENT_ERROR);
+        std::for_each(policy, documents.begin(), documents.end(),
+                      [this, &documents, &parsed_documents, &errors](const DocumentToAdd& document)
+                      {
+                            const size_t i = &document - documents.data();
+                            if (document.id < 0)
+                                errors[i] = AddDocumentError::INVALID_DOCUMENT_ID;
+                            else if (document_ordinals_.count(document.id))
+                                errors[i] = AddDocumentError::DUPLICATE_DOCUMENT_ID;
+                            else if (!ParseDocument(document.text, parsed_documents[i]))
+                                errors[i] = AddDocumentError::CONTAINS_SPECIAL_SYMBOLS;
+                      });
+
+        document_ordinals_.reserve(document_ordinals_.size() + documents.size());
+        document_ids_by_ordinal_.reserve(document_ids_by_ordinal_.size() + documents.size());
+        document_lengths_.reserve(document_lengths_.size() + documents.size());
+        document_ratings_.reserve(document_ratings_.size() + documents.size());
+        document_statuses_.reserve(document_statuses_.size() + documents.size());
+        for (size_t i = 0; i < documents.size(); ++i)
+        {
+            if (errors[i] != AddDocumentError::NO_ADD_DOCUMENT_ERROR)
+                continue;
+            // Повторы индексов внутри самого пакета выявляются только здесь
+            if (document_ordinals_.count(documents[i].id))
+                errors[i] = AddDocumentError::DUPLICATE_DOCUMENT_ID;
+            else
+                InsertDocument(documents[i].id, documents[i].status, ComputeAverageRating(documents[i].ratings),
+                               parsed_documents[i]);
+            parsed_documents[i] = ParsedDocument();
+        }
+        return errors;
+    }
+
     std::vector<Document> FindTopDocuments(const std::string_view raw_query,
                                                 DocumentStatus demand_status = DocumentStatus::ACTUAL) const;
-    std::vector<Document> FindTopDocuments(const std::string_view raw_query,
-                                           FilterPred filter_pred) const;
 
+    template <class DocumentPredicate, std::enable_if_t<IsDocumentPredicate<DocumentPredicate>(), int> = 0>
+    std::vector<Document> FindTopDocuments(const std::string_view raw_query, DocumentPredicate document_predicate) const
+    {
+        return FindTopDocuments(std::execution::seq, raw_query, document_predicate);
+    }
+
+    // Поиск с отбором по статусу. Если включён кэш результатов (см. SetQueryCacheCapacity), результат
+    // ищется в кэше по разобранному запросу, статусу и количеству выдаваемых документов.
     template <class ExecutionPolicy>
     std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy, const std::string_view raw_query,
                                            DocumentStatus demand_status = DocumentStatus::ACTUAL) const
     {
-        return FindTopDocuments(policy, raw_query,
-                                [demand_status](int document_id, DocumentStatus status, int rating) -> bool
-                                {return status == demand_status;});
+        QueryTrace trace;
+        QueryTrace* const trace_ptr = StartQueryTrace(trace);
+        QueryError query_error = QueryError::NO_QUERY_ERROR;
+
+        Query query;
+        {
+            const PhaseTimer phase_timer(trace_ptr, QueryPhase::PARSE);
+            query = ParseQuery(raw_query, query_error);
+        }
+        TestQueryErrorCode(query_error);
+
+        // Отбор по статусу сводится к проверке бита в карте документов с этим статусом
+        const OrdinalBitmap& status_ordinals = status_ordinals_[static_cast<size_t>(demand_status)];
+        const auto status_filter = [&status_ordinals](int ordinal)
+                                   {
+                                       return status_ordinals.Test(ordinal);
+                                   };
+        std::vector<Document> matched_documents;
+        if (!query_cache_)
+        {
+            matched_documents = FindTopDocumentsForPostings(policy, GetQueryPostings(query, trace_ptr), status_filter,
+                                                            trace_ptr);
+        }
+        else
+        {
+            QueryCacheKey cache_key{query.plus_terms, query.minus_terms, demand_status, max_result_document_count};
+            if (auto cached_documents = query_cache_->Find(cache_key, index_epoch_))
+            {
+                matched_documents = std::move(*cached_documents);
+            }
+            else
+            {
+                matched_documents = FindTopDocumentsForPostings(policy, GetQueryPostings(query, trace_ptr), status_filter,
+                                                                trace_ptr);
+                query_cache_->Insert(std::move(cache_key), index_epoch_, matched_documents);
+            }
+        }
+        FinishQueryTrace(raw_query, trace_ptr);
+        return matched_documents;
     }
 
+    // Постраничный поиск: следующая страница выдачи из не более чем max_result_document_count документов,
+    // идущих в порядке выдачи после last_document - последнего документа предыдущей страницы. Документы
+    // сравниваются с last_document по релевантности, рейтингу и индексу, поэтому страница отбирается
+    // так же, как первая: без увеличения количества выдаваемых документов и без упорядочения
+    // всех предыдущих страниц. Кэш результатов не используется.
+    std::vector<Document> FindTopDocumentsAfter(std::string_view raw_query, const Document& last_document,
+                                                DocumentStatus demand_status = DocumentStatus::ACTUAL) const;
+
     template <class ExecutionPolicy>
-    std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy, const std::string_view raw_query,
-                                           FilterPred filter_pred) const
+    std::vector<Document> FindTopDocumentsAfter(ExecutionPolicy&& policy, std::string_view raw_query,
+                                                const Document& last_document,
+                                                DocumentStatus demand_status = DocumentStatus::ACTUAL) const
     {
-        using namespace std;
+        QueryTrace trace;
+        QueryTrace* const trace_ptr = StartQueryTrace(trace);
+        QueryError query_error = QueryError::NO_QUERY_ERROR;
+
+        Query query;
+        {
+            const PhaseTimer phase_timer(trace_ptr, QueryPhase::PARSE);
+            query = ParseQuery(raw_query, query_error);
+        }
+        TestQueryErrorCode(query_error);
 
+        const OrdinalBitmap& status_ordinals = status_ordinals_[static_cast<size_t>(demand_status)];
+        const auto status_filter = [&status_ordinals](int ordinal)
+                                   {
+                                       return status_ordinals.Test(ordinal);
+                                   };
+        std::vector<Document> matched_documents = FindTopDocumentsForPostings(policy, GetQueryPostings(query, trace_ptr),
+                                                                              status_filter, trace_ptr, &last_document);
+        FinishQueryTrace(raw_query, trace_ptr);
+        return matched_documents;
+    }
+
+    // Поиск с отбором произвольным предикатом document_predicate(document_id, status, rating). Предикат
+    // подставляется в код поиска без косвенного вызова и вычисляется не более одного раза для каждого документа.
+    template <class ExecutionPolicy, class DocumentPredicate,
+              std::enable_if_t<IsDocumentPredicate<DocumentPredicate>(), int> = 0>
+    std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy, const std::string_view raw_query,
+                                           DocumentPredicate document_predicate) const
+    {
+        QueryTrace trace;
+        QueryTrace* const trace_ptr = StartQueryTrace(trace);
         QueryError query_error = QueryError::NO_QUERY_ERROR;
 
-        const Query query = ParseQuery(raw_query, query_error);
+        Query query;
+        {
+            const PhaseTimer phase_timer(trace_ptr, QueryPhase::PARSE);
+            query = ParseQuery(raw_query, query_error);
+        }
         TestQueryErrorCode(query_error);
 
-        auto matched_documents = FindAllDocuments(policy, query, filter_pred);
+        const auto predicate_filter = [this, &document_predicate](int ordinal)
+                                      {
+                                          return static_cast<bool>(document_predicate(document_ids_by_ordinal_[ordinal],
+                                                                                      document_statuses_[ordinal],
+                                                                                      document_ratings_[ordinal]));
+                                      };
+        std::vector<Document> matched_documents = FindTopDocumentsForPostings(policy, GetQueryPostings(query, trace_ptr),
+                                                                              predicate_filter, trace_ptr);
+        FinishQueryTrace(raw_query, trace_ptr);
+        return matched_documents;
+    }
+
+    // Пакетный поиск с отбором по статусу; результат i соответствует запросу raw_queries[i] (см. StreamTopDocumentsBatch)
+    template <class ExecutionPolicy>
+    std::vector<std::vector<Document>> FindTopDocumentsBatch(ExecutionPolicy&& policy,
+                                                             const std::vector<std::string>& raw_queries,
+                                                             DocumentStatus demand_status = DocumentStatus::ACTUAL) const
+    {
+        std::vector<std::vector<Document>> results(raw_queries.size());
+        StreamTopDocumentsBatch(policy, raw_queries,
+                                [&results](size_t query_index, auto&& documents)
+                                {
+                                    results[query_index] = std::forward<decltype(documents)>(documents);
+                                },
+                                demand_status);
+        return results;
+    }
+
+    // Пакетный поиск с отбором по статусу, передающий результат каждого запроса в sink(query_index, documents),
+    // как только он готов, без накопления результатов всего пакета. Результаты передаются в порядке готовности,
+    // а не в порядке запросов; вызовы sink не пересекаются по времени, но могут выполняться в разных потоках.
+    // Последнему из одинаковых запросов результат передаётся как std::vector<Document>&&, и sink может его забрать,
+    // остальным - как const std::vector<Document>&.
+    //
+    // Одинаковые запросы (в том числе различающиеся лишь порядком и повторами слов) выполняются один раз,
+    // списки вхождений и обратные частоты слов находятся один раз на весь пакет. Запросы распределяются между
+    // потоками (для параллельной политики) по убыванию оценки их трудоёмкости - суммарной длины списков
+    // вхождений плюс-слов, чтобы самые долгие запросы не оказались в конце пакета. Каждый запрос выполняется
+    // последовательно и обходит списки вхождений своих слов сам, с отсечением по MaxScore: общий обход списков
+    // несколькими запросами с общими словами не выполняется. При ошибке в любом из запросов исключение выбрасывается до поиска. Исключение, выброшенное
+    // при выполнении запроса или из sink, не прерывает остальные запросы пакета: оно сохраняется и выбрасывается
+    // после их завершения (при нескольких - исключение задачи, начатой раньше остальных в порядке распределения).
+    template <class ExecutionPolicy, class ResultSink>
+    void StreamTopDocumentsBatch(ExecutionPolicy&& policy, const std::vector<std::string>& raw_queries, ResultSink&& sink,
+                                 DocumentStatus demand_status = DocumentStatus::ACTUAL) const
+    {
+        using namespace std;
 
-        sort(policy, matched_documents.begin(), matched_documents.end(),
-            [](const Document& lhs, const Document& rhs)
+        // Повторы текстов запросов отбрасываются ещё до разбора
+        vector<size_t> text_indices(raw_queries.size());
+        vector<string_view> distinct_texts;
+        {
+            unordered_map<string_view, size_t> text_index_by_text;
+            for (size_t i = 0; i < raw_queries.size(); ++i)
             {
-                if (abs(lhs.relevance - rhs.relevance) < RELEVANCE_TOLERANCE)
-                    return lhs.rating > rhs.rating;
-                else
-                    return lhs.relevance > rhs.relevance;
-            });
-        if (static_cast<int>(matched_documents.size()) > max_result_document_count)
-            matched_documents.resize(max_result_document_count);
+                const auto [text_it, is_inserted] = text_index_by_text.emplace(raw_queries[i], distinct_texts.size());
+                if (is_inserted)
+                    distinct_texts.push_back(raw_queries[i]);
+                text_indices[i] = text_it->second;
+            }
+        }
 
-        return matched_documents;
+        vector<Query> queries(distinct_texts.size());
+        vector<QueryError> query_errors(distinct_texts.size(), QueryError::NO_QUERY_ERROR);
+        for_each(policy, distinct_texts.begin(), distinct_texts.end(),
+                 [this, &distinct_texts, &queries, &query_errors](const string_view& text)
+                 {
+                     const size_t i = &text - distinct_texts.data();
+                     queries[i] = ParseQuery(text, query_errors[i]);
+                 });
+        for (QueryError& query_error : query_errors)
+            TestQueryErrorCode(query_error);
+
+        QueryBatch batch = PlanQueryBatch(move(queries), demand_status);
+        vector<vector<size_t>> task_query_indices(batch.task_keys.size());
+        for (size_t i = 0; i < raw_queries.size(); ++i)
+            task_query_indices[batch.task_by_text[text_indices[i]]].push_back(i);
+
+        mutex sink_mutex;
+        const auto emit_task_results = [&sink, &sink_mutex, &task_query_indices](size_t task, vector<Document>&& documents)
+                                       {
+                                           lock_guard sink_lock(sink_mutex);
+                                           const vector<size_t>& query_indices = task_query_indices[task];
+                                           for (size_t i = 0; i + 1 < query_indices.size(); ++i)
+                                               sink(query_indices[i], as_const(documents));
+                                           sink(query_indices.back(), move(documents));
+                                       };
+
+        // Задачи, результаты которых есть в кэше, не выполняются
+        vector<size_t> pending_tasks;
+        pending_tasks.reserve(batch.task_keys.size());
+        for (size_t task = 0; task < batch.task_keys.size(); ++task)
+        {
+            if (query_cache_)
+                if (auto cached_documents = query_cache_->Find(batch.task_keys[task], index_epoch_))
+                {
+                    emit_task_results(task, move(*cached_documents));
+                    continue;
+                }
+            pending_tasks.push_back(task);
+        }
+        stable_sort(pending_tasks.begin(), pending_tasks.end(),
+                    [&batch](size_t lhs, size_t rhs)
+                    {
+                        return batch.task_costs[lhs] > batch.task_costs[rhs];
+                    });
+
+        // Исключение, покинувшее тело параллельного алгоритма, вызывает std::terminate, поэтому исключения
+        // задач перехватываются и выбрасываются после завершения всех задач
+        const OrdinalBitmap& status_ordinals = status_ordinals_[static_cast<size_t>(demand_status)];
+        vector<exception_ptr> task_errors(pending_tasks.size());
+        for_each(policy, pending_tasks.begin(), pending_tasks.end(),
+                 [this, &raw_queries, &batch, &task_query_indices, &status_ordinals, &emit_task_results, &pending_tasks,
+                  &task_errors](const size_t& task)
+                 {
+                     try
+                     {
+                         QueryTrace trace;
+                         QueryTrace* const trace_ptr = StartQueryTrace(trace);
+                         vector<Document> documents = FindTopDocumentsForPostings(execution::seq, batch.task_postings[task],
+                                                                                  [&status_ordinals](int ordinal)
+                                                                                  {
+                                                                                      return status_ordinals.Test(ordinal);
+                                                                                  },
+                                                                                  trace_ptr);
+                         FinishQueryTrace(raw_queries[task_query_indices[task].front()], trace_ptr);
+                         if (query_cache_)
+                             query_cache_->Insert(move(batch.task_keys[task]), index_epoch_, documents);
+                         emit_task_results(task, move(documents));
+                     }
+                     catch (...)
+                     {
+                         task_errors[&task - pending_tasks.data()] = current_exception();
+                     }
+                 });
+        for (const exception_ptr& task_error : task_errors)
+            if (task_error)
+                rethrow_exception(task_error);
     }
 
-    std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(std::string_view raw_query,
-                                                                  int document_id) const;
+    // Результат матчинга: слова запроса, присутствующие в документе, по алфавиту, и статус документа.
+    // Если в документе есть минус-слово запроса, список слов пуст.
+    using MatchedDocument = std::tuple<std::vector<std::string_view>, DocumentStatus>;
+
+    // Слова запроса пересекаются с прямым индексом документа за один проход по упорядоченным идентификаторам слов
+    MatchedDocument MatchDocument(std::string_view raw_query, int document_id) const;
 
-    template <class _ExecutionPolicy>
-    std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(_ExecutionPolicy&& policy,
-                                                                            const std::string_view raw_query, int document_id) const
+    // Матчинг одного документа выполняется последовательно при любой политике: пересечение запроса
+    // с прямым индексом документа короче, чем запуск параллельных задач
+    template <class ExecutionPolicy>
+    MatchedDocument MatchDocument(ExecutionPolicy&&, const std::string_view raw_query, int document_id) const
+    {
+        return MatchDocument(raw_query, document_id);
+    }
+
+    // Матчинг запроса с пакетом документов: запрос разбирается один раз, результат i соответствует
+    // document_ids[i]. Если хотя бы одного из документов нет, выбрасывается out_of_range.
+    std::vector<MatchedDocument> MatchDocuments(std::string_view raw_query, const std::vector<int>& document_ids) const;
+
+    // При параллельной политике документы пакета сопоставляются с запросом параллельно
+    template <class ExecutionPolicy>
+    std::vector<MatchedDocument> MatchDocuments(ExecutionPolicy&& policy, std::string_view raw_query,
+                                                const std::vector<int>& document_ids) const
     {
         using namespace std;
 
         QueryError query_error = QueryError::NO_QUERY_ERROR;
-
         const Query query = ParseQuery(raw_query, query_error);
         TestQueryErrorCode(query_error);
 
-        if (!documents_.count(document_id))
-            throw out_of_range("Матчинг документов : неверный идентификатор документа"s);
+        vector<int> ordinals(document_ids.size());
+        for (size_t i = 0; i < document_ids.size(); ++i)
+        {
+            ordinals[i] = FindOrdinal(document_ids[i]);
+            if (ordinals[i] == NO_ORDINAL)
+                throw out_of_range("Матчинг документов : неверный идентификатор документа"s);
+        }
 
-        vector<string_view> filtered_plus_words(query.plus_words.begin(), query.plus_words.end());
-        for_each(policy, filtered_plus_words.begin(), filtered_plus_words.end(),
-                [this, document_id](string_view& current_plus_word)
-                {
-                    if (!word_to_document_freqs_.count(current_plus_word))
-                        current_plus_word.remove_suffix(current_plus_word.size());
-                    else
-                        if (!word_to_document_freqs_.at(current_plus_word).count(document_id))
-                            current_plus_word.remove_suffix(current_plus_word.size());
-                });
-
-        bool is_minus_word = false;
-        for_each(policy, query.minus_words.begin(), query.minus_words.end(),
-                        [this, document_id, &is_minus_word](const string_view& current_minus_word)
-                        {
-                            if (word_to_document_freqs_.count(current_minus_word))
-                                if (word_to_document_freqs_.at(current_minus_word).count(document_id))
-                                    is_minus_word = true;
-                        });
-
-        vector<string_view> result;
-        if (!is_minus_word)
-            for (const string_view& current_plus_word : filtered_plus_words)
-                if (current_plus_word.size() > 0)
-                    result.push_back(current_plus_word);
-
-        return {result, documents_.at(document_id).status};
+        vector<MatchedDocument> matched_documents(ordinals.size());
+        transform(policy, ordinals.begin(), ordinals.end(), matched_documents.begin(),
+                  [this, &query](int ordinal)
+                  {
+                      return MatchOrdinal(query, ordinal);
+                  });
+        return matched_documents;
     }
 
     int GetDocumentCount() const;
-    const std::map<std::string_view, double>& GetWordFrequencies(int document_id) const;
+    // Слова документа и их частоты в документе, в порядке возрастания идентификаторов слов.
+    // Для отсутствующего документа возвращается пустой набор.
+    WordFrequencies GetWordFrequencies(int document_id) const;
     void RemoveDocument(int document_id);
 
     template <class ExecutionPolicy>
     void RemoveDocument(ExecutionPolicy&& policy, int document_id)
     {
-        if (!documents_.erase(document_id))
+        const int ordinal = FindOrdinal(document_id);
+        if (ordinal == NO_ORDINAL)
             return;
-        std::for_each(policy, word_to_document_freqs_.begin(), word_to_document_freqs_.end(),
-                      [document_id](auto& word_to_document_pair)
-                      {
-                            word_to_document_pair.second.erase(document_id);
-                      });
 
-        // Зачищаем элементы словаря word_to_document_freqs_, для которых не осталось документов
-        for (auto word_to_document_it = word_to_document_freqs_.begin();
-            word_to_document_it != word_to_document_freqs_.end();)
+        // Удаление затрагивает только слова самого документа
+        std::vector<TermId> document_terms;
+        const ForwardEntries forward_entries = forward_index_.GetDocument(ordinal);
+        document_terms.reserve(forward_entries.size());
+        for (const ForwardEntry& entry : forward_entries)
+            document_terms.push_back(entry.term_id);
+        forward_index_.RemoveDocument(ordinal);
+
+        if (removal_mode_ == RemovalMode::DEFERRED)
         {
-            auto next_it = next(word_to_document_it);
-            if (!word_to_document_it->second.size())
-                word_to_document_freqs_.erase(word_to_document_it);
-            word_to_document_it = next_it;
+            for (const TermId term_id : document_terms)
+                word_to_document_freqs_[term_id].MarkPendingRemoval();
+            pending_removal_terms_.insert(pending_removal_terms_.end(), document_terms.begin(), document_terms.end());
+            removed_ordinals_.Set(ordinal);
+            ++pending_removal_count_;
         }
+        else
+        {
+            std::for_each(policy, document_terms.begin(), document_terms.end(),
+                          [this, ordinal](TermId term_id)
+                          {
+                                word_to_document_freqs_[term_id].Erase(ordinal);
+                          });
+            ReleaseEmptyTerms(document_terms);
+        }
+
+        status_ordinals_[static_cast<size_t>(document_statuses_[ordinal])].Reset(ordinal);
+        document_ordinals_.erase(document_id);
+        document_ids_.erase(document_id);
+        document_ids_by_ordinal_[ordinal] = REMOVED_DOCUMENT_ID;
+        ++index_epoch_;
+        CompactTermArenaIfSparse();
+
+        if (pending_removal_count_ >= AUTO_COMPACTION_MIN_PENDING_COUNT &&
+            pending_removal_count_ * AUTO_COMPACTION_RATIO >= GetDocumentCount())
+            CompactIndex(policy);
+        // Без отложенных удалений уплотнять списки нечего, но порядковые номера удалённых документов
+        // возвращаются, когда их набирается не меньше, чем действующих документов
+        else if (is_auto_ordinal_renumbering_ && pending_removal_count_ == 0 &&
+                 GetOrdinalGapCount() >= ORDINAL_RENUMBERING_MIN_GAP_COUNT &&
+                 GetOrdinalGapCount() >= document_ordinals_.size())
+            RenumberOrdinals(policy);
     }
 
+    void SetRemovalMode(RemovalMode removal_mode);
+    RemovalMode GetRemovalMode() const;
+    // Включает или выключает автоматическую перенумерацию документов при немедленном удалении (по умолчанию
+    // включена). Перенумерация переписывает все списки вхождений и массивы по порядковым номерам, то есть
+    // занимает O(вхождений + документов), и удаление, на котором она срабатывает, выполняется во много раз
+    // дольше обычного. Если такие всплески задержки недопустимы, перенумерацию выключают и возвращают номера
+    // удалённых документов вызовом CompactIndex в удобный момент.
+    void SetAutoOrdinalRenumbering(bool is_enabled);
+    bool IsAutoOrdinalRenumbering() const;
+    // Количество логически удалённых документов, которые ещё присутствуют в списках вхождений
+    int GetPendingRemovalCount() const;
+    // Вычёркивает логически удалённые документы из списков вхождений и перенумеровывает документы подряд,
+    // возвращая место порядковых номеров удалённых документов. Вызывается автоматически, когда
+    // таких документов накапливается не меньше AUTO_COMPACTION_MIN_PENDING_COUNT и не меньше
+    // 1/AUTO_COMPACTION_RATIO от количества действующих документов.
+    void CompactIndex();
+
+    template <class ExecutionPolicy>
+    void CompactIndex(ExecutionPolicy&& policy)
+    {
+        std::sort(pending_removal_terms_.begin(), pending_removal_terms_.end());
+        pending_removal_terms_.erase(std::unique(pending_removal_terms_.begin(), pending_removal_terms_.end()),
+                                     pending_removal_terms_.end());
+        std::for_each(policy, pending_removal_terms_.begin(), pending_removal_terms_.end(),
+                      [this](TermId term_id)
+                      {
+                            word_to_document_freqs_[term_id].EraseMarked(removed_ordinals_, document_lengths_);
+                      });
+        ReleaseEmptyTerms(pending_removal_terms_);
+
+        pending_removal_terms_.clear();
+        removed_ordinals_.Clear();
+        pending_removal_count_ = 0;
+        if (GetOrdinalGapCount() > 0)
+            RenumberOrdinals(policy);
+        CompactTermArenaIfSparse();
+    }
+
+    // Переписывает слова индекса в новые блоки арены словаря, возвращая ресурсу памяти место слов, освобождённых
+    // вместе с удалёнными документами. Вызывается автоматически после удаления документов, когда освобождённые
+    // слова занимают в арене не меньше ARENA_COMPACTION_MIN_DEAD_BYTES и не меньше, чем действующие.
+    // Строки, полученные ранее из MatchDocument и GetWordFrequencies, становятся недействительными.
+    void CompactTermArena();
+
+    // Включает или выключает сжатие списков вхождений (см. PostingList). Сжатые списки занимают в несколько
+    // раз меньше памяти, зато чтение их требует декодирования блоков. Новые списки создаются с той же настройкой.
+    void SetPostingCompression(bool is_compressed);
+
+    template <class ExecutionPolicy>
+    void SetPostingCompression(ExecutionPolicy&& policy, bool is_compressed)
+    {
+        is_posting_compressed_ = is_compressed;
+        std::for_each(policy, word_to_document_freqs_.begin(), word_to_document_freqs_.end(),
+                      [is_compressed](PostingList& posting_list)
+                      {
+                            posting_list.SetCompressed(is_compressed);
+                      });
+    }
+
+    bool IsPostingCompressed() const;
+
+    // Включает кэш результатов поиска с отбором по статусу, хранящий не более capacity запросов;
+    // нулевая ёмкость выключает кэш. Любое добавление или удаление документа делает кэш недействительным.
+    void SetQueryCacheCapacity(size_t capacity);
+    QueryCacheStats GetQueryCacheStats() const;
+
+    // Заранее вычисляет обратные частоты всех слов для текущего состояния индекса, чтобы первые запросы
+    // после пакета изменений не тратили на это время. Без вызова обратные частоты вычисляются по мере надобности.
+    void PrecomputeInverseDocumentFreqs() const;
+
+    // Включает или выключает замеры запросов: количество и длительность запросов и их этапов (см. QueryPhase)
+    // и журнал медленных запросов. Выключение сбрасывает накопленные показатели. Выключенные замеры
+    // не требуют ни чтения часов, ни обращений к общим счётчикам.
+    void SetMetricsEnabled(bool is_enabled);
+    bool IsMetricsEnabled() const;
+    // Запросы, выполнявшиеся не меньше threshold, попадают в журнал медленных запросов
+    // (хранятся последние SearchMetrics::SLOW_QUERY_LOG_CAPACITY)
+    void SetSlowQueryThreshold(std::chrono::nanoseconds threshold);
+    // Снимок показателей запросов и индекса; подсчёт количества вхождений обходит все списки вхождений
+    SearchStats GetStats() const;
+
     int GetSetResultDocumentCount(int new_result_document_count) const;
 
-    class iterator : public std::iterator <std::bidirectional_iterator_tag, const int>
+    // Сохраняет индекс в двоичный снимок (см. index_snapshot.h). В снимок попадают стоп-слова, словарь,
+    // списки вхождений, прямой индекс, рейтинги и статусы действующих документов; логически удалённые
+    // документы отбрасываются, порядковые номера документов и идентификаторы слов перенумеровываются подряд.
+    // Прежний файл path заменяется только полностью записанным снимком.
+    void SaveSnapshot(const std::string& path) const;
+    // Заменяет содержимое индекса содержимым снимка. Файл отображается в память, массивы снимка копируются
+    // в собственные структуры индекса без разбора текста документов: словарь собирается заново, а списки
+    // вхождений сверяются с прямым индексом, поэтому загрузка стоит O(размер индекса), а не только чтения файла.
+    void LoadSnapshot(const std::string& path);
+
+    class iterator
     {
     public:
         friend class SearchServer;
 
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = int;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const int*;
+        using reference = const int&;
+
         iterator(const SearchServer *searchserver_ptr, bool begin_or_end);
         iterator& operator++();
         iterator operator++(int);
@@ -197,7 +669,7 @@ public:
 
     private:
         const SearchServer *linked_search_server_ptr;
-        std::map<int, DocumentData>::const_iterator documents_it;
+        std::set<int>::const_iterator documents_it;
     };
 
     friend class iterator;
@@ -214,71 +686,414 @@ private:
     // Некоторые константы, используемые в работе поисковиком
     static constexpr int DEFAULT_MAX_RESULT_DOCUMENT_COUNT = 5; // Умолчательное количество выдаваемых по запросу документов
     static constexpr double RELEVANCE_TOLERANCE = 1e-6;
+    static constexpr int REMOVED_DOCUMENT_ID = -1; // Индекс документа для порядкового номера удалённого документа
+    static constexpr int NO_ORDINAL = -1; // Порядковый номер отсутствующего документа
+    static constexpr size_t DOCUMENT_STATUS_COUNT = static_cast<size_t>(DocumentStatus::REMOVED) + 1;
+    // Условия автоматического уплотнения индекса при отложенном удалении документов
+    static constexpr int AUTO_COMPACTION_MIN_PENDING_COUNT = 1024;
+    static constexpr int AUTO_COMPACTION_RATIO = 4;
+    // Условие автоматической перенумерации документов при немедленном удалении: количество
+    // порядковых номеров удалённых документов
+    static constexpr size_t ORDINAL_RENUMBERING_MIN_GAP_COUNT = 1024;
+    // Условие автоматического уплотнения арены словаря: объём освобождённых слов в байтах
+    static constexpr size_t ARENA_COMPACTION_MIN_DEAD_BYTES = 1024 * 1024;
+    // Минимальное количество порядковых номеров документов в отрезке при параллельном поиске
+    static constexpr int MIN_ORDINAL_RANGE_SIZE = 4096;
     // Действительное, текущее количество выдаваемых по запросу документов
     mutable int max_result_document_count = DEFAULT_MAX_RESULT_DOCUMENT_COUNT;
     //Множество стоп-слов класса
-    std::set<std::string, std::less<>> stop_words_;
-    //Множество всех слов, имеющихся в зарегистрированных документах.
-    std::set<std::string, std::less<>> words_collection_;
-    // Словарь word_to_document_freqs_ преобразует слова запроса в список содержащих их документов.
-    // Этот список, в свою очередь, содержит индекс документа и относительную частоту данного слова в документе.
-    std::map<std::string_view, std::map<int, double>> word_to_document_freqs_;
-    //Словарь documents_ - список зарегистрированных в системе документов. Индекс эемента словаря - индекс документа,
-    //содержание элемента словаря типа DocumentData - некоторая информация о нём.
-    std::map<int, DocumentData> documents_;
-    static const std::map<std::string_view, double> empty_word_freqs;
+    TermDictionary stop_words_;
+    //Множество всех слов, имеющихся в зарегистрированных документах. Идентификатор слова в этом словаре
+    //используется как номер его списка вхождений и как представление слова в запросе.
+    TermDictionary words_collection_;
+    // Массив word_to_document_freqs_ по идентификатору слова выдаёт список содержащих его документов.
+    // Этот список, в свою очередь, содержит порядковые номера документов и количества вхождений данного
+    // слова в них, упорядоченные по возрастанию порядковых номеров (см. PostingList). Идентификаторы слов
+    // освобождаются вместе с последним содержащим их документом, а соответствующие списки остаются пустыми
+    // до повторной выдачи идентификатора.
+    std::vector<PostingList> word_to_document_freqs_;
+    bool is_posting_compressed_ = false;
+    // Прямой индекс: слова каждого документа по его порядковому номеру
+    ForwardIndex forward_index_;
+    // Порядковые номера зарегистрированных в системе документов по их индексам
+    std::unordered_map<int, int> document_ordinals_;
+    // Индексы зарегистрированных документов по возрастанию, в этом порядке документы перебирает iterator
+    std::set<int> document_ids_;
+    // Индексы документов по их порядковым номерам. Порядковые номера выдаются документам подряд
+    // при добавлении и не используются повторно, так что списки вхождений пополняются только с конца.
+    // Номера удалённых документов возвращаются перенумерацией действующих подряд с сохранением порядка
+    // (см. RenumberOrdinals), поэтому массивы по порядковым номерам не растут при постоянной смене документов.
+    std::vector<int> document_ids_by_ordinal_;
+    // Рейтинги и статусы документов по их порядковым номерам. Отбор документов и сборка выдачи читают
+    // их прямо из массивов, не разыскивая документ по индексу.
+    std::vector<int> document_ratings_;
+    std::vector<DocumentStatus> document_statuses_;
+    // Длины документов (количество слов без стоп-слов) по их порядковым номерам. Частота слова в документе -
+    // количество его вхождений из списка вхождений, делённое на длину документа.
+    std::vector<uint32_t> document_lengths_;
+    RemovalMode removal_mode_ = RemovalMode::IMMEDIATE;
+    bool is_auto_ordinal_renumbering_ = true;
+    // Порядковые номера документов, удалённых логически, но ещё присутствующих в списках вхождений.
+    // Поиск пропускает такие документы, проверяя бит в этой карте.
+    OrdinalBitmap removed_ordinals_;
+    // Порядковые номера действующих документов с каждым из статусов; индекс массива - значение DocumentStatus
+    std::array<OrdinalBitmap, DOCUMENT_STATUS_COUNT> status_ordinals_;
+    // Слова логически удалённых документов, списки вхождений которых ждут уплотнения (возможны повторы)
+    std::vector<TermId> pending_removal_terms_;
+    int pending_removal_count_ = 0;
+    // Эпоха индекса, увеличивается при каждом добавлении и удалении документа
+    uint64_t index_epoch_ = 0;
+    std::unique_ptr<QueryResultCache> query_cache_;
+    std::unique_ptr<SearchMetrics> metrics_; // Пуст, если замеры выключены
+    std::chrono::nanoseconds slow_query_threshold_ = SearchMetrics::DEFAULT_SLOW_QUERY_THRESHOLD;
 
     //---- Частные функции класса SearchServer ------
     static void TestQueryErrorCode(QueryError& query_error);
     bool IsStopWord(std::string_view word) const;
-    std::vector<std::string_view> SplitIntoWordsNoStop(const std::string_view& text,
-                                                  bool *is_special_symbols = nullptr) const;
+    // Разбивает текст на слова, кроме стоп-слов, записывая их в words вместо прежнего содержимого
+    void SplitIntoWordsNoStop(std::string_view text, std::vector<std::string_view>& words,
+                              bool *is_special_symbols = nullptr) const;
 
     static int ComputeAverageRating(const std::vector<int>& ratings);
-    double ComputeWordInverseDocumentFreq(const std::string_view& word) const;
+    // Разбирает текст документа, не изменяя индекс; возвращает false, если текст содержит недопустимые символы
+    bool ParseDocument(std::string_view text, ParsedDocument& parsed_document) const;
+    // Порядковый номер документа либо NO_ORDINAL, если документа нет
+    int FindOrdinal(int document_id) const;
+    // Матчинг разобранного запроса с документом, заданным порядковым номером
+    MatchedDocument MatchOrdinal(const Query& query, int ordinal) const;
+    // Добавляет разобранный документ в индекс под очередным порядковым номером
+    void InsertDocument(int document_id, DocumentStatus status, int rating, const ParsedDocument& parsed_document);
+    // Удаляет из словаря слова, списки вхождений которых опустели
+    void ReleaseEmptyTerms(const std::vector<TermId>& term_ids);
+    // Уплотняет арену словаря, если освобождённые слова занимают в ней слишком много места
+    void CompactTermArenaIfSparse();
+
+    // Количество порядковых номеров, оставшихся от удалённых документов
+    size_t GetOrdinalGapCount() const
+    {
+        return document_ids_by_ordinal_.size() - document_ordinals_.size();
+    }
+
+    // Перенумеровывает действующие документы подряд с сохранением порядка во всех структурах индекса,
+    // кроме списков вхождений; возвращает новые порядковые номера по прежним (NO_ORDINAL - у удалённых)
+    std::vector<int> RenumberDocumentOrdinals();
+
+    // Перенумеровывает документы подряд, включая списки вхождений. Списки не должны содержать
+    // логически удалённых документов.
+    template <class ExecutionPolicy>
+    void RenumberOrdinals(ExecutionPolicy&& policy)
+    {
+        const std::vector<int> new_ordinals = RenumberDocumentOrdinals();
+        std::for_each(policy, word_to_document_freqs_.begin(), word_to_document_freqs_.end(),
+                      [this, &new_ordinals](PostingList& posting_list)
+                      {
+                            posting_list.RenumberDocuments(new_ordinals, document_lengths_);
+                      });
+    }
+    // Обратная частота слова. Вычисляется при первом обращении в каждой эпохе индекса и сохраняется рядом
+    // со списком вхождений слова, так что повторные обращения не вызывают log().
+    double ComputeWordInverseDocumentFreq(TermId term_id) const;
+
+    // Частота слова в документе, на котором стоит курсор его списка вхождений
+    double GetTermFreq(const PostingList::Cursor& cursor) const
+    {
+        return cursor.GetTermCount() / static_cast<double>(document_lengths_[cursor.GetDocumentId()]);
+    }
 
     QueryWord ParseQueryWord(std::string_view text, QueryError& query_word_error) const;
     Query ParseQuery(std::string_view text, QueryError& query_error) const;
+    // Разбивает диапазон порядковых номеров документов на отрезки [first, second) для независимой обработки
+    std::vector<std::pair<int, int>> SplitOrdinalRange(bool is_parallel) const;
+    QueryPostings GetQueryPostings(const Query& query, QueryTrace* trace = nullptr) const;
+
+    // Начинает замер запроса; возвращает nullptr, если замеры выключены
+    QueryTrace* StartQueryTrace(QueryTrace& trace) const
+    {
+        if (!metrics_)
+            return nullptr;
+        trace.start_time = QueryTrace::Clock::now();
+        return &trace;
+    }
+
+    void FinishQueryTrace(std::string_view raw_query, const QueryTrace* trace) const
+    {
+        if (trace)
+            metrics_->RecordQuery(raw_query, *trace);
+    }
+    // Объединяет одинаковые запросы в задачи и находит списки вхождений и обратные частоты слов всех задач
+    QueryBatch PlanQueryBatch(std::vector<Query> queries, DocumentStatus demand_status) const;
+    // Количество документов-кандидатов запроса: суммарная длина списков вхождений плюс-слов
+    static size_t CountCandidates(const QueryPostings& query_postings);
+    // Порядок выдачи документов: по убыванию релевантности, при равной с точностью RELEVANCE_TOLERANCE
+    // релевантности - по убыванию рейтинга, при равном рейтинге - по возрастанию индекса
+    static bool IsMoreRelevant(const Document& lhs, const Document& rhs);
+
+    // Идёт ли документ в порядке выдачи после last_document; при нулевом last_document - всегда
+    static bool IsAfterDocument(const Document& document, const Document* last_document)
+    {
+        return !last_document || IsMoreRelevant(*last_document, document);
+    }
 
     template <class ExecutionPolicy>
-    std::vector<Document> FindAllDocuments(ExecutionPolicy&& policy, const Query& query, FilterPred document_predicate) const
+    static constexpr bool IsParallelPolicy()
+    {
+        return !std::is_same_v<std::decay_t<ExecutionPolicy>, std::execution::sequenced_policy>;
+    }
+
+    // Поиск лучших документов по спискам вхождений слов запроса. document_filter(ordinal) отбирает документы
+    // по их порядковым номерам и вызывается не более одного раза для каждого документа. Если задан
+    // last_document, рассматриваются только документы, идущие в порядке выдачи после него.
+    template <class ExecutionPolicy, class DocumentFilter>
+    std::vector<Document> FindTopDocumentsForPostings(ExecutionPolicy&& policy, const QueryPostings& query_postings,
+                                                      const DocumentFilter& document_filter, QueryTrace* trace = nullptr,
+                                                      const Document* last_document = nullptr) const
     {
         using namespace std;
 
-        ConcurrentMap<int, double> document_to_relevance(4096);
+        // Если все документы-кандидаты заведомо помещаются в выдачу, отсекать нечего,
+        // и полный подсчёт релевантностей обходится дешевле, чем поиск с отсечением
+        vector<Document> matched_documents;
+        if (CountCandidates(query_postings) <= static_cast<size_t>(max_result_document_count))
+            matched_documents = FindAllDocuments(policy, query_postings, document_filter, trace, last_document);
+        else
+            matched_documents = FindTopKDocuments(policy, query_postings, document_filter, max_result_document_count, trace,
+                                                  last_document);
+
+        const PhaseTimer phase_timer(trace, QueryPhase::SORT);
+        sort(policy, matched_documents.begin(), matched_documents.end(), IsMoreRelevant);
+        if (static_cast<int>(matched_documents.size()) > max_result_document_count)
+            matched_documents.resize(max_result_document_count);
 
-        auto plus_func = [this, &document_predicate, &document_to_relevance](const string_view word)
+        return matched_documents;
+    }
+
+    template <class ExecutionPolicy, class DocumentFilter>
+    std::vector<Document> FindAllDocuments(ExecutionPolicy&& policy, const QueryPostings& query_postings,
+                                           const DocumentFilter& document_filter, QueryTrace* trace,
+                                           const Document* last_document) const
+    {
+        using namespace std;
+
+        const auto& [plus_postings, minus_postings] = query_postings;
+        ScoreAccumulator::Lease document_to_relevance;
+        document_to_relevance->Reset(document_ids_by_ordinal_.size());
+
+        // Каждый отрезок порядковых номеров обрабатывается независимо и пишет только в свои ячейки накопителя
+        const vector<pair<int, int>> ordinal_ranges = SplitOrdinalRange(IsParallelPolicy<ExecutionPolicy>());
+        vector<vector<Document>> range_documents(ordinal_ranges.size());
+
+        auto range_func = [this, &document_filter, &document_to_relevance, &plus_postings, &minus_postings,
+                           &ordinal_ranges, &range_documents, trace, last_document](const pair<int, int>& ordinal_range)
         {
-            if (word_to_document_freqs_.count(word) == 0)
-                return;
-            const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-            for (const auto [document_id, term_freq] : word_to_document_freqs_.at(word))
+            const auto [first_ordinal, last_ordinal] = ordinal_range;
+            ScoreAccumulator& accumulator = *document_to_relevance;
+            vector<int> touched_ordinals;
+
+            std::optional<PhaseTimer> phase_timer(std::in_place, trace, QueryPhase::POSTING_SCAN);
+            for (const auto& [posting_list_ptr, inverse_document_freq] : plus_postings)
             {
-                if (documents_.count(document_id))
+                for (PostingList::Cursor cursor(*posting_list_ptr, first_ordinal, last_ordinal);
+                     cursor.GetDocumentId() != PostingList::NO_DOCUMENT; cursor.Next())
                 {
-                    const auto& document_data = documents_.at(document_id);
-                    if (document_predicate(document_id, document_data.status, document_data.rating))
-                        document_to_relevance[document_id].refv += term_freq * inverse_document_freq;
+                    const int ordinal = cursor.GetDocumentId();
+                    if (removed_ordinals_.Test(ordinal))
+                        continue;
+                    if (accumulator.Add(ordinal, GetTermFreq(cursor) * inverse_document_freq))
+                        touched_ordinals.push_back(ordinal);
                 }
             }
-        };
 
-        for_each(policy, query.plus_words.begin(), query.plus_words.end(), plus_func);
+            phase_timer.emplace(trace, QueryPhase::MINUS_ELIMINATION);
+            for (const PostingList *posting_list_ptr : minus_postings)
+                for (PostingList::Cursor cursor(*posting_list_ptr, first_ordinal, last_ordinal);
+                     cursor.GetDocumentId() != PostingList::NO_DOCUMENT; cursor.Next())
+                    accumulator.Exclude(cursor.GetDocumentId());
 
-        auto minus_func = [this, &document_predicate, &document_to_relevance](const string_view word)
-        {
-            if (word_to_document_freqs_.count(word) == 0)
-                return;
-            for (const auto [document_id, _] : word_to_document_freqs_.at(word))
-                document_to_relevance.erase(document_id);
+            phase_timer.emplace(trace, QueryPhase::RESULT_BUILD);
+            sort(touched_ordinals.begin(), touched_ordinals.end());
+            vector<Document>& matched_documents = range_documents[&ordinal_range - ordinal_ranges.data()];
+            // Фильтр применяется один раз к каждому документу, набравшему релевантность
+            for (const int ordinal : touched_ordinals)
+            {
+                if (!accumulator.IsActive(ordinal))
+                    continue;
+                const Document document(document_ids_by_ordinal_[ordinal], accumulator.GetScore(ordinal),
+                                        document_ratings_[ordinal]);
+                if (IsAfterDocument(document, last_document) && document_filter(ordinal))
+                    matched_documents.push_back(document);
+            }
         };
 
-        for_each(policy, query.minus_words.begin(), query.minus_words.end(), minus_func);
+        for_each(policy, ordinal_ranges.begin(), ordinal_ranges.end(), range_func);
 
+        const PhaseTimer phase_timer(trace, QueryPhase::RESULT_BUILD);
         vector<Document> matched_documents;
-        for (const auto [document_id, relevance] : document_to_relevance.BuildOrdinaryMap())
-            matched_documents.push_back({document_id, relevance,
-                                        documents_.at(document_id).rating});
+        for (vector<Document>& current_documents : range_documents)
+            matched_documents.insert(matched_documents.end(), current_documents.begin(), current_documents.end());
         return matched_documents;
     }
+
+    // Поиск лучших top_count документов с динамическим отсечением по алгоритму MaxScore. Слова запроса
+    // упорядочиваются по верхней границе вклада в релевантность. Как только накоплено top_count документов,
+    // слова, сумма границ которых не дотягивает до релевантности худшего из них, становятся "несущественными":
+    // документы, содержащие только такие слова, не рассматриваются вовсе, а несущественные списки вхождений
+    // лишь догоняют кандидатов экспоненциальным поиском и бросаются, как только документ не может попасть в выдачу.
+    template <class ExecutionPolicy, class DocumentFilter>
+    std::vector<Document> FindTopKDocuments(ExecutionPolicy&& policy, const QueryPostings& query_postings,
+                                            const DocumentFilter& document_filter, size_t top_count, QueryTrace* trace,
+                                            const Document* last_document) const
+    {
+        using namespace std;
+
+        std::optional<PhaseTimer> phase_timer(std::in_place, trace, QueryPhase::POSTING_SCAN);
+        const vector<pair<int, int>> ordinal_ranges = SplitOrdinalRange(IsParallelPolicy<ExecutionPolicy>());
+        vector<vector<Document>> range_documents(ordinal_ranges.size());
+        transform(policy, ordinal_ranges.begin(), ordinal_ranges.end(), range_documents.begin(),
+                  [this, &query_postings, &document_filter, top_count, last_document](const pair<int, int>& ordinal_range)
+                  {
+                      return FindTopKDocumentsInRange(query_postings, document_filter, top_count, ordinal_range,
+                                                      last_document);
+                  });
+
+        phase_timer.emplace(trace, QueryPhase::RESULT_BUILD);
+        vector<Document> matched_documents;
+        for (vector<Document>& current_documents : range_documents)
+            matched_documents.insert(matched_documents.end(), current_documents.begin(), current_documents.end());
+        return matched_documents;
+    }
+
+    template <class DocumentFilter>
+    std::vector<Document> FindTopKDocumentsInRange(const QueryPostings& query_postings, const DocumentFilter& document_filter,
+                                                   size_t top_count, std::pair<int, int> ordinal_range,
+                                                   const Document* last_document) const
+    {
+        using namespace std;
+
+        const auto [first_ordinal, last_ordinal] = ordinal_range;
+        const auto& [plus_postings, minus_postings] = query_postings;
+
+        vector<TermCursor> cursors;
+        for (size_t i = 0; i < plus_postings.size(); ++i)
+        {
+            const auto [posting_list_ptr, inverse_document_freq] = plus_postings[i];
+            const PostingList::Cursor posting_cursor(*posting_list_ptr, first_ordinal, last_ordinal);
+            if (posting_cursor.GetDocumentId() != PostingList::NO_DOCUMENT)
+                cursors.push_back({posting_cursor, inverse_document_freq,
+                                   posting_list_ptr->GetMaxTermFreq() * inverse_document_freq, i});
+        }
+        sort(cursors.begin(), cursors.end(),
+             [](const TermCursor& lhs, const TermCursor& rhs)
+             {
+                 return lhs.max_score < rhs.max_score;
+             });
+        // cumulative_max_scores[i] - верхняя граница суммарного вклада слов с номерами 0..i
+        vector<double> cumulative_max_scores(cursors.size());
+        double max_score_sum = 0;
+        for (size_t i = 0; i < cursors.size(); ++i)
+        {
+            max_score_sum += cursors[i].max_score;
+            cumulative_max_scores[i] = max_score_sum;
+        }
+
+        vector<PostingList::Cursor> minus_cursors;
+        minus_cursors.reserve(minus_postings.size());
+        for (const PostingList *posting_list_ptr : minus_postings)
+            minus_cursors.emplace_back(*posting_list_ptr, first_ordinal, last_ordinal);
+
+        // Документ может опередить худший документ выдачи, лишь превзойдя его релевантность хотя бы на
+        // -RELEVANCE_TOLERANCE (при более близких релевантностях решает рейтинг). Отсекаем с удвоенным запасом,
+        // чтобы погрешность суммирования границ не отбросила такой документ.
+        double threshold = -numeric_limits<double>::infinity();
+        size_t first_essential = 0;
+        vector<double> term_scores(plus_postings.size());
+        vector<Document> top_documents;
+        top_documents.reserve(top_count + 1);
+
+        while (true)
+        {
+            int candidate_ordinal = PostingList::NO_DOCUMENT;
+            for (size_t i = first_essential; i < cursors.size(); ++i)
+                candidate_ordinal = min(candidate_ordinal, cursors[i].GetOrdinal());
+            if (candidate_ordinal == PostingList::NO_DOCUMENT)
+                break;
+
+            fill(term_scores.begin(), term_scores.end(), 0);
+            double score = 0;
+            for (size_t i = first_essential; i < cursors.size(); ++i)
+            {
+                TermCursor& cursor = cursors[i];
+                if (cursor.GetOrdinal() == candidate_ordinal)
+                {
+                    const double term_score = GetTermFreq(cursor.posting_cursor) * cursor.inverse_document_freq;
+                    term_scores[cursor.query_index] = term_score;
+                    score += term_score;
+                    cursor.posting_cursor.Next();
+                }
+            }
+
+            bool is_pruned = false;
+            for (size_t i = first_essential; i-- > 0;)
+            {
+                if (score + cumulative_max_scores[i] < threshold - 2 * RELEVANCE_TOLERANCE)
+                {
+                    is_pruned = true;
+                    break;
+                }
+                TermCursor& cursor = cursors[i];
+                cursor.posting_cursor.SeekTo(candidate_ordinal);
+                if (cursor.GetOrdinal() == candidate_ordinal)
+                {
+                    const double term_score = GetTermFreq(cursor.posting_cursor) * cursor.inverse_document_freq;
+                    term_scores[cursor.query_index] = term_score;
+                    score += term_score;
+                }
+            }
+            if (is_pruned || removed_ordinals_.Test(candidate_ordinal))
+                continue;
+
+            bool is_minus_word = false;
+            for (size_t i = 0; i < minus_cursors.size() && !is_minus_word; ++i)
+            {
+                minus_cursors[i].SeekTo(candidate_ordinal);
+                is_minus_word = minus_cursors[i].GetDocumentId() == candidate_ordinal;
+            }
+            if (is_minus_word)
+                continue;
+
+            // Релевантность суммируется в порядке слов запроса, как и при полном подсчёте
+            double relevance = 0;
+            for (const double term_score : term_scores)
+                relevance += term_score;
+            const Document document(document_ids_by_ordinal_[candidate_ordinal], relevance,
+                                    document_ratings_[candidate_ordinal]);
+            if (!IsAfterDocument(document, last_document) || !document_filter(candidate_ordinal))
+                continue;
+
+            if (top_documents.size() < top_count)
+            {
+                top_documents.push_back(document);
+                push_heap(top_documents.begin(), top_documents.end(), IsMoreRelevant);
+            }
+            else if (IsMoreRelevant(document, top_documents.front()))
+            {
+                pop_heap(top_documents.begin(), top_documents.end(), IsMoreRelevant);
+                top_documents.back() = document;
+                push_heap(top_documents.begin(), top_documents.end(), IsMoreRelevant);
+            }
+            else
+            {
+                continue;
+            }
+
+            if (top_documents.size() == top_count)
+            {
+                // На вершине кучи - худший из отобранных документов
+                threshold = top_documents.front().relevance;
+                while (first_essential < cursors.size() &&
+                       cumulative_max_scores[first_essential] < threshold - 2 * RELEVANCE_TOLERANCE)
+                    ++first_essential;
+            }
+        }
+        return top_documents;
+    }
 };
@@ -1,60 +1,177 @@
+#include <cstdint>
 #include <string>
 #include <string_view>
 #include <vector>
 #include "string_processing.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define STRING_PROCESSING_SSE2
+#include <emmintrin.h>
+#endif
+#if defined(STRING_PROCESSING_SSE2) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define STRING_PROCESSING_AVX2
+#include <immintrin.h>
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
 using namespace std;
 
-vector<string_view> SplitIntoWords(const string_view& text, bool *is_special_symbols)
+namespace
 {
-    vector<string_view> words;
-    size_t start_word_position = 0;
+    // Способ проверки недопустимых символов. SplitIntoWords исторически сравнивает символ как char со знаком,
+    // и байты от 128 и выше тоже считаются недопустимыми; SplitIntoWordsString сравнивает байт без знака.
+    enum class MarginCheck
+    {
+        SIGNED,
+        UNSIGNED
+    };
 
-    if (is_special_symbols) *is_special_symbols = false;
-    for (size_t i = 0; i < text.size(); ++i)
+    // Состояние разбиения: слова дописываются в words, start_word_position - начало текущего слова
+    struct SplitState
     {
-        char c = text[i];
-        if (c < SPECIAL_SYMBOLS_MARGIN && is_special_symbols)
-            *is_special_symbols = true;
-        if (c == ' ')
+        string_view text;
+        vector<string_view>& words;
+        size_t start_word_position = 0;
+        bool is_special_symbols = false;
+
+        void EndWord(size_t space_position)
         {
-            string_view word(text);
-            word.remove_suffix(text.size() - i);
-            word.remove_prefix(start_word_position);
-            if (!word.empty()) words.push_back(word);
-            start_word_position = i + 1;
+            if (space_position > start_word_position)
+                words.push_back(text.substr(start_word_position, space_position - start_word_position));
+            start_word_position = space_position + 1;
         }
-    }
-    if (start_word_position < text.size())
+
+        // Завершает слова перед каждым пробелом блока; бит i маски space_mask соответствует символу block_position + i
+        void EndWords(size_t block_position, uint32_t space_mask)
+        {
+            while (space_mask)
+            {
+                EndWord(block_position + CountTrailingZeros(space_mask));
+                space_mask &= space_mask - 1;
+            }
+        }
+
+        static unsigned CountTrailingZeros(uint32_t mask)
+        {
+#ifdef _MSC_VER
+            unsigned long index;
+            _BitScanForward(&index, mask);
+            return index;
+#else
+            return __builtin_ctz(mask);
+#endif
+        }
+    };
+
+    // Блочный сканер обрабатывает текст целыми блоками и возвращает количество обработанных символов;
+    // остаток текста, меньший блока, разбирается посимвольно
+    using BlockScanner = size_t (*)(SplitState& state, MarginCheck margin_check);
+
+#ifndef STRING_PROCESSING_SSE2
+    size_t ScanScalar(SplitState&, MarginCheck)
     {
-        string_view word(text);
-        word.remove_prefix(start_word_position);
-        words.push_back(word);
+        return 0;
     }
-    return words;
-}
+#endif
 
-vector<string> SplitIntoWordsString(const string_view& text, bool *is_special_symbols)
-{
-    vector<string> words;
-    string word;
+#ifdef STRING_PROCESSING_SSE2
+    size_t ScanSse2(SplitState& state, MarginCheck margin_check)
+    {
+        constexpr size_t BLOCK_SIZE = 16;
+        const __m128i spaces = _mm_set1_epi8(' ');
+        const __m128i margin = _mm_set1_epi8(SPECIAL_SYMBOLS_MARGIN);
+        const __m128i max_special_symbol = _mm_set1_epi8(SPECIAL_SYMBOLS_MARGIN - 1);
+        __m128i special_symbols = _mm_setzero_si128();
+        const char *data = state.text.data();
+        size_t position = 0;
+        for (; position + BLOCK_SIZE <= state.text.size(); position += BLOCK_SIZE)
+        {
+            const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + position));
+            special_symbols = _mm_or_si128(special_symbols, margin_check == MarginCheck::SIGNED
+                                               ? _mm_cmplt_epi8(block, margin)
+                                               : _mm_cmpeq_epi8(_mm_min_epu8(block, max_special_symbol), block));
+            state.EndWords(position, _mm_movemask_epi8(_mm_cmpeq_epi8(block, spaces)));
+        }
+        state.is_special_symbols |= _mm_movemask_epi8(special_symbols) != 0;
+        return position;
+    }
+#endif
 
-    if (is_special_symbols) *is_special_symbols = false;
-    for (const unsigned char c : text)
+#ifdef STRING_PROCESSING_AVX2
+    __attribute__((target("avx2")))
+    size_t ScanAvx2(SplitState& state, MarginCheck margin_check)
     {
-        if (c < SPECIAL_SYMBOLS_MARGIN && is_special_symbols)
-            *is_special_symbols = true;
-        if (c == ' ')
+        constexpr size_t BLOCK_SIZE = 32;
+        const __m256i spaces = _mm256_set1_epi8(' ');
+        const __m256i margin = _mm256_set1_epi8(SPECIAL_SYMBOLS_MARGIN);
+        const __m256i max_special_symbol = _mm256_set1_epi8(SPECIAL_SYMBOLS_MARGIN - 1);
+        __m256i special_symbols = _mm256_setzero_si256();
+        const char *data = state.text.data();
+        size_t position = 0;
+        for (; position + BLOCK_SIZE <= state.text.size(); position += BLOCK_SIZE)
         {
-            if (!word.empty()) words.push_back(word);
-            word = "";
+            const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + position));
+            special_symbols = _mm256_or_si256(special_symbols, margin_check == MarginCheck::SIGNED
+                                                  ? _mm256_cmpgt_epi8(margin, block)
+                                                  : _mm256_cmpeq_epi8(_mm256_min_epu8(block, max_special_symbol), block));
+            state.EndWords(position, static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, spaces))));
         }
-        else
+        state.is_special_symbols |= _mm256_movemask_epi8(special_symbols) != 0;
+        return position;
+    }
+#endif
+
+    // Выбирает самый широкий набор векторных инструкций, поддерживаемый процессором
+    BlockScanner ChooseBlockScanner()
+    {
+#ifdef STRING_PROCESSING_AVX2
+        if (__builtin_cpu_supports("avx2"))
+            return ScanAvx2;
+#endif
+#ifdef STRING_PROCESSING_SSE2
+        return ScanSse2;
+#else
+        return ScanScalar;
+#endif
+    }
+
+    void Split(string_view text, vector<string_view>& words, bool *is_special_symbols, MarginCheck margin_check)
+    {
+        static const BlockScanner block_scanner = ChooseBlockScanner();
+
+        words.clear();
+        SplitState state{text, words};
+        for (size_t i = block_scanner(state, margin_check); i < text.size(); ++i)
         {
-            word += c;
+            const char c = text[i];
+            if (margin_check == MarginCheck::SIGNED ? c < SPECIAL_SYMBOLS_MARGIN
+                                                    : static_cast<unsigned char>(c) < SPECIAL_SYMBOLS_MARGIN)
+                state.is_special_symbols = true;
+            if (c == ' ')
+                state.EndWord(i);
         }
+        state.EndWord(text.size());
+        if (is_special_symbols) *is_special_symbols = state.is_special_symbols;
     }
-    if (!word.empty()) words.push_back(word);
+}
 
+vector<string_view> SplitIntoWords(const string_view& text, bool *is_special_symbols)
+{
+    vector<string_view> words;
+    SplitIntoWords(text, words, is_special_symbols);
     return words;
 }
+
+void SplitIntoWords(string_view text, vector<string_view>& words, bool *is_special_symbols)
+{
+    Split(text, words, is_special_symbols, MarginCheck::SIGNED);
+}
+
+vector<string> SplitIntoWordsString(const string_view& text, bool *is_special_symbols)
+{
+    vector<string_view> word_views;
+    Split(text, word_views, is_special_symbols, MarginCheck::UNSIGNED);
+    return vector<string>(word_views.begin(), word_views.end());
+}
@@ -7,5 +7,9 @@ static constexpr char SPECIAL_SYMBOLS_MARGIN = 32;
 
 std::vector<std::string_view> SplitIntoWords(const std::string_view& text,
                                              bool *is_special_symbols = nullptr);
+// Разбивает text на слова, записывая их в words вместо прежнего содержимого. Повторное использование
+// одного и того же вектора избавляет от выделения памяти под результат при каждом вызове.
+void SplitIntoWords(std::string_view text, std::vector<std::string_view>& words,
+                    bool *is_special_symbols = nullptr);
 std::vector<std::string> SplitIntoWordsString(const std::string_view& text,
                                    bool *is_special_symbols = nullptr);
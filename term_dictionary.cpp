@@ -0,0 +1,193 @@
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include "term_dictionary.h"
+
+using namespace std;
+
+TermDictionary::TermDictionary(const TermDictionary& other)
+    : memory_resource_(other.memory_resource_), live_term_bytes_(other.live_term_bytes_), terms_(other.terms_),
+      term_hashes_(other.term_hashes_), slots_(other.slots_), free_term_ids_(other.free_term_ids_)
+{
+    // Слова пока указывают в арену other; уплотнение переписывает их в собственную арену
+    CompactArena();
+}
+
+TermDictionary& TermDictionary::operator=(const TermDictionary& other)
+{
+    if (this != &other)
+        *this = TermDictionary(other);
+    return *this;
+}
+
+TermId TermDictionary::Intern(string_view term)
+{
+    const TermId found_term_id = Find(term);
+    if (found_term_id != NO_TERM)
+        return found_term_id;
+
+    // Заполненность таблицы поддерживается не выше половины, чтобы цепочки проб оставались короткими
+    if ((size() + 1) * 2 > slots_.size())
+        Rehash(max(MIN_SLOT_COUNT, slots_.size() * 2));
+
+    const size_t hash = HashTerm(term);
+    TermId term_id = terms_.size();
+    if (free_term_ids_.empty())
+    {
+        terms_.push_back(StoreInArena(term));
+        term_hashes_.push_back(hash);
+    }
+    else
+    {
+        term_id = free_term_ids_.back();
+        free_term_ids_.pop_back();
+        terms_[term_id] = StoreInArena(term);
+        term_hashes_[term_id] = hash;
+    }
+    live_term_bytes_ += term.size();
+
+    const size_t mask = slots_.size() - 1;
+    size_t slot = hash & mask;
+    while (slots_[slot] != NO_TERM)
+        slot = (slot + 1) & mask;
+    slots_[slot] = term_id;
+    return term_id;
+}
+
+TermId TermDictionary::Find(string_view term) const
+{
+    if (slots_.empty())
+        return NO_TERM;
+    const size_t hash = HashTerm(term);
+    const size_t mask = slots_.size() - 1;
+    for (size_t slot = hash & mask; slots_[slot] != NO_TERM; slot = (slot + 1) & mask)
+    {
+        const TermId term_id = slots_[slot];
+        if (term_hashes_[term_id] == hash && terms_[term_id] == term)
+            return term_id;
+    }
+    return NO_TERM;
+}
+
+void TermDictionary::Release(TermId term_id)
+{
+    const size_t mask = slots_.size() - 1;
+    size_t free_slot = term_hashes_[term_id] & mask;
+    while (slots_[free_slot] != term_id)
+        free_slot = (free_slot + 1) & mask;
+
+    // Удаление со сдвигом: элементы цепочки проб, следующие за освободившейся ячейкой, переносятся в неё,
+    // если их исходная ячейка не лежит между освободившейся и текущей. Так в таблице не остаётся "надгробий".
+    for (size_t slot = (free_slot + 1) & mask; slots_[slot] != NO_TERM; slot = (slot + 1) & mask)
+    {
+        const size_t home_slot = term_hashes_[slots_[slot]] & mask;
+        const bool is_in_place = free_slot <= slot ? (free_slot < home_slot && home_slot <= slot)
+                                                   : (free_slot < home_slot || home_slot <= slot);
+        if (!is_in_place)
+        {
+            slots_[free_slot] = slots_[slot];
+            free_slot = slot;
+        }
+    }
+    slots_[free_slot] = NO_TERM;
+    free_term_ids_.push_back(term_id);
+    live_term_bytes_ -= terms_[term_id].size();
+}
+
+vector<string_view> TermDictionary::GetTerms() const
+{
+    vector<TermId> term_ids;
+    term_ids.reserve(size());
+    for (const TermId term_id : slots_)
+        if (term_id != NO_TERM)
+            term_ids.push_back(term_id);
+    sort(term_ids.begin(), term_ids.end());
+
+    vector<string_view> terms;
+    terms.reserve(term_ids.size());
+    for (const TermId term_id : term_ids)
+        terms.push_back(terms_[term_id]);
+    return terms;
+}
+
+void TermDictionary::CompactArena()
+{
+    // Прежние блоки освобождаются после переноса всех слов, так как слова копируются прямо из них
+    const vector<ArenaChunk> old_arena_chunks = move(arena_chunks_);
+    arena_chunks_.clear();
+    arena_chunk_used_ = ARENA_CHUNK_SIZE;
+    arena_reserved_bytes_ = 0;
+    arena_used_bytes_ = 0;
+
+    vector<bool> is_free(terms_.size(), false);
+    for (const TermId term_id : free_term_ids_)
+        is_free[term_id] = true;
+    for (TermId term_id = 0; term_id < terms_.size(); ++term_id)
+        terms_[term_id] = is_free[term_id] ? string_view() : StoreInArena(terms_[term_id]);
+}
+
+TermArenaStats TermDictionary::GetArenaStats() const
+{
+    TermArenaStats stats;
+    stats.chunk_count = arena_chunks_.size();
+    stats.reserved_bytes = arena_reserved_bytes_;
+    stats.used_bytes = arena_used_bytes_;
+    stats.live_bytes = live_term_bytes_;
+    return stats;
+}
+
+size_t TermDictionary::HashTerm(string_view term)
+{
+    return hash<string_view>{}(term);
+}
+
+TermDictionary::ArenaChunk TermDictionary::AllocateArenaChunk(size_t size)
+{
+    arena_reserved_bytes_ += size;
+    return ArenaChunk(static_cast<char*>(memory_resource_->allocate(size, 1)), ArenaChunkDeleter(memory_resource_, size));
+}
+
+string_view TermDictionary::StoreInArena(string_view term)
+{
+    // Пустому слову место в арене не нужно, а у пустой арены нет текущего блока
+    if (term.empty())
+        return {};
+    arena_used_bytes_ += term.size();
+    if (term.size() > ARENA_CHUNK_SIZE)
+    {
+        // Слишком длинное слово получает отдельный блок. Блок ставится перед текущим, чтобы тот продолжал заполняться.
+        ArenaChunk term_chunk = AllocateArenaChunk(term.size());
+        char *term_place = term_chunk.get();
+        memcpy(term_place, term.data(), term.size());
+        arena_chunks_.insert(arena_chunks_.empty() ? arena_chunks_.end() : prev(arena_chunks_.end()), move(term_chunk));
+        return {term_place, term.size()};
+    }
+    if (arena_chunk_used_ + term.size() > ARENA_CHUNK_SIZE)
+    {
+        arena_chunks_.push_back(AllocateArenaChunk(ARENA_CHUNK_SIZE));
+        arena_chunk_used_ = 0;
+    }
+    char *term_place = arena_chunks_.back().get() + arena_chunk_used_;
+    memcpy(term_place, term.data(), term.size());
+    arena_chunk_used_ += term.size();
+    return {term_place, term.size()};
+}
+
+void TermDictionary::Rehash(size_t slot_count)
+{
+    slots_.assign(slot_count, NO_TERM);
+    const size_t mask = slot_count - 1;
+    vector<bool> is_free(terms_.size(), false);
+    for (const TermId term_id : free_term_ids_)
+        is_free[term_id] = true;
+    for (TermId term_id = 0; term_id < terms_.size(); ++term_id)
+    {
+        if (is_free[term_id])
+            continue;
+        size_t slot = term_hashes_[term_id] & mask;
+        while (slots_[slot] != NO_TERM)
+            slot = (slot + 1) & mask;
+        slots_[slot] = term_id;
+    }
+}
@@ -0,0 +1,111 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <memory_resource>
+#include <string_view>
+#include <vector>
+
+using TermId = uint32_t;
+
+// Заполненность арены словаря (см. TermDictionary::GetArenaStats)
+struct TermArenaStats
+{
+    size_t chunk_count = 0;
+    size_t reserved_bytes = 0; // Выделено под блоки арены
+    size_t used_bytes = 0;     // Занято словами, в том числе освобождёнными
+    size_t live_bytes = 0;     // Занято словами, присутствующими в словаре
+};
+
+// Словарь слов. Каждое слово хранится один раз в блочной области памяти (арене) и получает
+// 32-битный идентификатор; поиск идентификатора по слову выполняется по хеш-таблице с открытой адресацией.
+// Идентификаторы выдаются подряд, начиная с нуля, так что по ним можно адресовать обычные массивы;
+// идентификаторы освобождённых слов выдаются повторно. Блоки арены выделяются из ресурса памяти, переданного
+// при создании словаря. Строки, возвращаемые GetTerm, остаются действительными до уплотнения арены
+// (см. CompactArena) или уничтожения словаря, в том числе после освобождения слова.
+class TermDictionary
+{
+public:
+    static constexpr TermId NO_TERM = std::numeric_limits<TermId>::max();
+
+    // Ресурс памяти должен существовать дольше словаря
+    explicit TermDictionary(std::pmr::memory_resource* memory_resource = std::pmr::get_default_resource())
+        : memory_resource_(memory_resource)
+    {}
+
+    // Копия получает собственную арену из того же ресурса памяти, слова переписываются в неё плотно
+    TermDictionary(const TermDictionary& other);
+    TermDictionary& operator=(const TermDictionary& other);
+    TermDictionary(TermDictionary&&) = default;
+    TermDictionary& operator=(TermDictionary&&) = default;
+
+    // Возвращает идентификатор слова, при необходимости добавляя слово в словарь
+    TermId Intern(std::string_view term);
+    // Возвращает идентификатор слова либо NO_TERM, если слова в словаре нет
+    TermId Find(std::string_view term) const;
+    // Удаляет слово из словаря, его идентификатор может быть выдан следующему добавленному слову
+    void Release(TermId term_id);
+    // Все слова словаря в порядке возрастания их идентификаторов
+    std::vector<std::string_view> GetTerms() const;
+    // Переписывает слова словаря в новые блоки арены, возвращая ресурсу памяти место освобождённых слов.
+    // Прежние строки, полученные из GetTerm, становятся недействительными; идентификаторы слов не меняются.
+    void CompactArena();
+    TermArenaStats GetArenaStats() const;
+
+    std::pmr::memory_resource* GetMemoryResource() const
+    {
+        return memory_resource_;
+    }
+
+    std::string_view GetTerm(TermId term_id) const
+    {
+        return terms_[term_id];
+    }
+
+    // Количество слов в словаре
+    size_t size() const
+    {
+        return terms_.size() - free_term_ids_.size();
+    }
+
+private:
+    static constexpr size_t ARENA_CHUNK_SIZE = 64 * 1024;
+    static constexpr size_t MIN_SLOT_COUNT = 16;
+
+    // Возвращает блок арены ресурсу памяти, из которого он был выделен
+    class ArenaChunkDeleter
+    {
+    public:
+        ArenaChunkDeleter(std::pmr::memory_resource* memory_resource, size_t size)
+            : memory_resource_(memory_resource), size_(size)
+        {}
+
+        void operator()(char* chunk) const
+        {
+            memory_resource_->deallocate(chunk, size_, 1);
+        }
+
+    private:
+        std::pmr::memory_resource* memory_resource_;
+        size_t size_;
+    };
+
+    using ArenaChunk = std::unique_ptr<char[], ArenaChunkDeleter>;
+
+    std::pmr::memory_resource* memory_resource_;
+    std::vector<ArenaChunk> arena_chunks_;
+    size_t arena_chunk_used_ = ARENA_CHUNK_SIZE; // Занято байт в последнем блоке арены
+    size_t arena_reserved_bytes_ = 0;
+    size_t arena_used_bytes_ = 0;
+    size_t live_term_bytes_ = 0;
+    std::vector<std::string_view> terms_; // Слова по их идентификаторам, указывают в арену
+    std::vector<size_t> term_hashes_; // Хеши слов по их идентификаторам, чтобы не пересчитывать их при перестроении
+    std::vector<TermId> slots_; // Хеш-таблица идентификаторов, размер - степень двойки, NO_TERM - пустая ячейка
+    std::vector<TermId> free_term_ids_; // Идентификаторы освобождённых слов
+
+    static size_t HashTerm(std::string_view term);
+    ArenaChunk AllocateArenaChunk(size_t size);
+    std::string_view StoreInArena(std::string_view term);
+    void Rehash(size_t slot_count);
+};